@@ -54,6 +54,7 @@ int Nop (int a, int b, int c, int d) {
 }
 
 int Fork (void) {
+  TtyFlush(-1);		/* or the child prints our pending output again */
   YSYSCALL(YALNIX_FORK, 0, 0, 0, 0);
 }
 
@@ -62,6 +63,7 @@ int Exec (char *a, char **b) {
 }
 
 void _Exit (int a) {
+  TtyFlush(-1);		/* exit and Exit both end up here */
   YSYSCALL_NR(YALNIX_EXIT, a, 0 , 0 ,0);
   // should not return...
 }
@@ -83,6 +85,7 @@ int Delay (int a) {
 }
 
 int TtyRead (int a, void *b, int c) {
+  TtyFlush(a);		/* so a prompt shows before we wait for input */
   YSYSCALL(YALNIX_TTY_READ, a, b, c, 0);
 }
 
@@ -99,7 +102,7 @@ int Send (void *a, int b) {
 }
 
 int Receive (void * a) {
-  YSYSCALL(YALNIX_RECEIVE, 0, 0, 0, 0);
+  YSYSCALL(YALNIX_RECEIVE, a, 0, 0, 0);
 }
 
 int ReceiveSpecific (void *a, int b) {
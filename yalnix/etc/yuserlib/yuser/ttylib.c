@@ -5,24 +5,11 @@
 #include "trace.h"
 #include "manuallink.h"
 
-static char tty_buff[4096];		/* really big */
-
 #ifndef TR_IM_WHO
 #define TR_IM_WHO TR_IM_USER
 #endif
 
-int
-TtyPrintf(int tty_id, char * fmt, ...)
-{
-    va_list args;
-
-    va_start(args, fmt);
-    vsprintf(tty_buff, fmt, args);
-    va_end(args);
-
-    return (TtyWrite(tty_id, tty_buff, strlen(tty_buff)));
-}
-
+/* TtyPrintf and the terminal output streams live in ttystream.c */
 
 void
 TracePrintf(int level, char * fmt, ...)
@@ -0,0 +1,109 @@
+/*
+ * ttystream.c: buffered terminal output for the Yalnix user library.
+ *
+ * Kept apart from ttylib.c, which needs the support library's trace
+ * headers, so it builds from the headers in include/ alone.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "hardware.h"
+#include "yalnix.h"
+
+static char tty_buff[4096];		/* really big */
+
+/*
+ * One output stream per terminal.  Bytes collect in the stream's
+ * buffer and go to the kernel in one TtyWrite when the buffer fills,
+ * at a newline in line buffered mode, on TtyFlush, before a TtyRead
+ * of the same terminal, before Fork (so the child does not print the
+ * parent's pending output a second time) and at exit.
+ */
+struct tty_stream {
+    char buffer[TTY_STREAM_LEN];
+    int len;
+    int mode;			/* TTY_BUFFER_LINE is 0, so that is the default */
+};
+
+static struct tty_stream tty_streams[NUM_TERMINALS];
+
+int
+TtySetBuffering(int tty_id, int mode)
+{
+    if (tty_id < 0 || tty_id >= NUM_TERMINALS)
+	return (ERROR);
+    if (mode != TTY_BUFFER_LINE && mode != TTY_BUFFER_FULL && mode != TTY_BUFFER_NONE)
+	return (ERROR);
+    if (TtyFlush(tty_id) == ERROR)
+	return (ERROR);
+    tty_streams[tty_id].mode = mode;
+    return (0);
+}
+
+int
+TtyFlush(int tty_id)
+{
+    struct tty_stream *s;
+    int len;
+
+    if (tty_id < 0) {
+	/* flush them all */
+	int rc = 0;
+	for (tty_id = 0; tty_id < NUM_TERMINALS; tty_id++)
+	    if (TtyFlush(tty_id) == ERROR)
+		rc = ERROR;
+	return (rc);
+    }
+    if (tty_id >= NUM_TERMINALS)
+	return (ERROR);
+
+    s = &tty_streams[tty_id];
+    len = s->len;
+    if (len == 0)
+	return (0);
+    s->len = 0;
+    return (TtyWrite(tty_id, s->buffer, len) == len ? 0 : ERROR);
+}
+
+int
+TtyStreamWrite(int tty_id, void *buf, int len)
+{
+    struct tty_stream *s;
+
+    if (tty_id < 0 || tty_id >= NUM_TERMINALS || len < 0)
+	return (ERROR);
+    s = &tty_streams[tty_id];
+
+    if (s->mode == TTY_BUFFER_NONE)
+	return (TtyWrite(tty_id, buf, len));
+
+    if (len > TTY_STREAM_LEN - s->len) {
+	if (TtyFlush(tty_id) == ERROR)
+	    return (ERROR);
+	/* too big to be worth buffering */
+	if (len >= TTY_STREAM_LEN)
+	    return (TtyWrite(tty_id, buf, len));
+    }
+
+    memcpy(s->buffer + s->len, buf, len);
+    s->len += len;
+    if (s->mode == TTY_BUFFER_LINE && memchr(buf, '\n', len) != NULL) {
+	if (TtyFlush(tty_id) == ERROR)
+	    return (ERROR);
+    }
+    return (len);
+}
+
+int
+TtyPrintf(int tty_id, char * fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsprintf(tty_buff, fmt, args);
+    va_end(args);
+
+    return (TtyStreamWrite(tty_id, tty_buff, strlen(tty_buff)));
+}
@@ -16,6 +16,11 @@ struct pagetable
 #define R0PAGES			(VMEM_0_SIZE 			/ PAGESIZE)
 #define R1PAGES			(VMEM_1_SIZE			/ PAGESIZE)
 
+// the two pages right below the kernel stack are kept free so the kernel can temporarily map frames
+// there to reach memory that is not part of its own address space. The kernel heap never grows into them
+#define KWINDOW_PAGE0	(KSTACK_PAGE0 - 1)
+#define KWINDOW_PAGE1	(KSTACK_PAGE0 - 2)
+
 extern unsigned int gNumPagesR0;
 extern unsigned int gNumPagesR1;
 extern unsigned int gKStackPages;
@@ -32,6 +37,7 @@ struct UserProgPageTable
 {
 	PageTableEntry m_pte[R1PAGES];
 	PageTableEntry m_kstack[KSTACK_PAGES];
+	unsigned char m_cow[R1PAGES];		// set for pages mapped read only because their frame is shared
 };
 
 typedef struct KernelPageTable KernelPageTable;
@@ -53,5 +59,6 @@ extern FrameTableEntry gFreeFramePool;
 extern FrameTableEntry gUsedFramePool;
 extern KernelPageTable gKernelPageTable;
 extern UserProgPageTable* gCurrentR1PageTable;
+extern unsigned char* gFrameShareCount;			// the number of extra mappings of each physical frame
 
 #endif
@@ -10,8 +10,11 @@
 #include <hardware.h>
 #include <pagetable.h>
 #include <stdbool.h>
+#include <yalnix.h>
 
 extern int gPID;            // the global pid counter that can be given to executing processes
+
+#define MAX_PRIORITY 31     // priorities range from 0 (default) to MAX_PRIORITY. higher runs first
 extern void* gKernelBrk;    // the global kernel brk
 
 // The process control block is the central structure that allows for the kernel to manage the processes.
@@ -24,11 +27,25 @@ struct ProcessControlBlock
     UserProgPageTable* m_pagetable;                 //  pointer to the actual user mode page table.
     unsigned int m_brk;                             // the brk location of this process.
     unsigned int m_ticks;                           // increment the number of ticks this process has been running for
+    int m_donatedQuantum;                           // set when another process handed us the rest of its quantum
     unsigned int m_timeToSleep;                     // how long we expect to sleep for
+    int m_timedOut;                                 // set when a timed wait expired before the process was woken up
+    int m_basePriority;                             // the priority the process asked for with SetPriority
+    int m_priority;                                 // the effective priority, raised by waiters on locks we hold
+    struct LockQueueNode* m_blockedOnLock;          // the lock this process is waiting for, used to follow donation chains
+    int m_waitLength;                               // the number of bytes a blocked pipe reader is waiting for
+    char m_msg[MESSAGE_SIZE];                       // the message being sent, replaced by the reply once it arrives
+    struct PCBQueue* m_senderQ;                     // senders waiting for this process to Receive them
+    int m_ipcPartner;                               // pid we are sending to, or the pid we want to receive from (0 for any)
+    int m_ipcStatus;                                // ERROR until our Send has been replied to
     struct ProcessControlBlock* m_next;             // doubly linked list next pointers
     struct ProcessControlBlock* m_prev;             // doubly linked list prev pointers
     struct ExitDataQueue* m_edQ;                    // singly linked list of exit data
+    struct SyncRef* m_heldLocks;                    // locks and reader-writer locks currently held by this process
+    struct SyncRef* m_ownedSyncs;                   // synchronization primitives created by this process
+    struct SyncRef* m_sharedSyncs;                  // primitives inherited from the parent at fork
     char* m_name;                                   // name of the process
+    struct ProcessControlBlock* m_tableNext;        // next entry in the table of live processes
 };
 
 typedef struct ProcessControlBlock PCB;
@@ -43,23 +60,40 @@ struct PCBQueue
 
 typedef struct PCBQueue PCBQueue;
 
+// A process blocked in Poll leaves one of these on every pipe or terminal it is polling.
+// The process itself waits in gPollBlockedQ, since a PCB can only sit in one queue
+struct PollWaiter
+{
+    PCB* m_pcb;
+    struct PollWaiter* m_next;
+};
+
+typedef struct PollWaiter PollWaiter;
+
 // the global list of processes that the kernel will actually manage
 extern PCBQueue gRunningProcessQ;
 extern PCBQueue gReadyToRunProcessQ;
 extern PCBQueue gWaitProcessQ;
 extern PCBQueue gTerminatedProcessQ;
 extern PCBQueue gSleepBlockedQ;
-extern PCBQueue gWriteBlockedQ;
 extern PCBQueue gWriteFinishedQ;
-extern PCBQueue gWriteWaitQ;                    // waiting for a chance to write to a terminal
-extern PCBQueue gReadBlockedQ;
+extern PCBQueue gWriteWaitQ[NUM_TERMINALS];     // writers waiting for their turn on each terminal, in order
+extern PCBQueue gReadBlockedQ[NUM_TERMINALS];    // readers waiting for input on each terminal, in order
+extern PCBQueue gTicketWaitQ[NUM_TERMINALS];     // processes waiting for an asynchronous write to go out
 extern PCBQueue gReadFinishedQ;
 extern PCBQueue gExitedQ;
+extern PCBQueue gPollBlockedQ;                  // processes waiting in Poll
+extern PCBQueue gReceiveBlockedQ;               // servers waiting in Receive for a sender
+extern PCBQueue gReplyBlockedQ;                 // senders that were received and wait for the Reply
+
+extern PCB* gProcessTable;                      // every live process, whatever queue it is in
+extern int gServerTable[MAX_SERVER_INDEX + 1];  // pid registered at each server index, -1 if free
 
 // Function headers defined in process.c
 PCB* processDequeue(PCBQueue* Q);
 void processEnqueue(PCBQueue* Q, PCB* process);
 void processRemove(PCBQueue* Q, PCB* process);
+void processQueueAppend(PCBQueue* destQ, PCBQueue* srcQ);
 PCB* getPcbByPid(PCBQueue* Q, int pid);
 PCB* getPcbByPidInLocks(int pid);
 PCB* getPcbByPidInCVars(int pid);
@@ -67,12 +101,22 @@ PCB* getChildOfPpid(PCBQueue* Q, int ppid);
 PCB* getChildOfPpidInLocks(int ppid);
 PCB* getChildOfPpidInCVars(int ppid);
 PCB* getHeadProcess(PCBQueue* Q);
+PCB* getHighestPriorityProcess(PCBQueue* Q);
 bool isEmptyProcessQueue(PCBQueue* Q);
 int getProcessQueueSize(PCBQueue* Q);
 void removeFromQueue(PCBQueue* Q, PCB* process);
 void freePCB(PCB* pcb);
+void processTableAdd(PCB* pcb);
+void processTableRemove(PCB* pcb);
+PCB* getProcessByPid(int pid);
+PCB* getChildByPpid(int ppid);
 void freeExitedProcesses();
 
+// poll waiter lists
+int pollWaiterAdd(PollWaiter** list, PCB* pcb);
+void pollWaiterRemove(PollWaiter** list, PCB* pcb);
+void wakePollers(PollWaiter* list);
+
 // Struct for keeping track of the data of a terminated process
 struct ExitData
 {
@@ -5,8 +5,29 @@
 #ifndef __SCHEDULER_H__
 #define __SCHEDULER_H__
 
+// A kernel timer bounds how long a process stays blocked in a waiting queue.
+// When the ticks run out the clock pulls the process out of the queue and marks it as timed out.
+struct KernelTimer
+{
+    PCB* m_pcb;                         // the process that is blocked
+    PCBQueue* m_waitingQueue;           // the queue the process is blocked in
+    int m_ticks;                        // clock ticks left before the wait expires
+    struct KernelTimer* m_next;
+};
+
+typedef struct KernelTimer KernelTimer;
+
+extern KernelTimer* gKernelTimers;      // list of armed kernel timers
+extern int gClockTicks;                 // clock interrupts since boot
+
 void scheduleSleepingProcesses();
 
+int addKernelTimer(PCB* pcb, PCBQueue* waitingQueue, int ticks);
+void cancelKernelTimer(PCB* pcb);
+void scheduleTimedOutProcesses();
+
 int scheduler(PCBQueue* destQueue, PCB* currpcb, UserContext* ctx, char* errormessage);
+int handoff(PCBQueue* destQueue, PCB* currpcb, PCB* nextpcb, UserContext* ctx, char* errormessage);
+int switchToProcess(PCBQueue* destQueue, PCB* currpcb, PCB* nextpcb, UserContext* ctx, char* errormessage);
 
 #endif
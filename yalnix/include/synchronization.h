@@ -13,6 +13,9 @@ Description: Contains the synchronization primitives provided by yalnix to the u
 #define LOCK_MASK 0x10000000			// we use a value of 1 for locks
 #define CVAR_MASK 0x20000000			// we use a value of 2 for cvars
 #define PIPE_MASK 0x30000000			// we use a value of 3 for pipes
+#define RWLOCK_MASK 0x40000000			// we use a value of 4 for reader-writer locks
+#define BARRIER_MASK 0x50000000			// we use a value of 5 for barriers
+#define SYNC_TYPE_MASK 0x70000000		// the bits of the compound id that hold the synchronization primitive type
 #define SYNC_SHIFT 28					// number of bits to shift to get the bits of the synchronization primitive
 
 #define LOCKED 1
@@ -25,6 +28,8 @@ enum SYNC_TYPE
 	SYNC_LOCK,
 	SYNC_CVAR,
 	SYNC_PIPE,
+	SYNC_RWLOCK,
+	SYNC_BARRIER,
 	SYNC_UNDEFINED
 };
 
@@ -32,7 +37,7 @@ typedef enum SYNC_TYPE SyncType;
 
 extern int gSID;            // the global unique id counter that can be given to new locks/cvars/pipes
 
-// utility functions to handle the 3 different types of synchronization primitives
+// utility functions to handle the different types of synchronization primitives
 
 // This method should be used to get unique ids for creation of any synchronization primivites
 // rather than handling the gSID variable directly. This function increments, adds mask and provides the
@@ -45,11 +50,38 @@ SyncType getSyncType(int compoundId);
 // THis function strips the compound id from its type and returns just the id
 int getSyncIdOnly(int compoundId);
 
+// Each process keeps lists of the primitives it holds and owns so that they
+// can be handed off and reclaimed when the process exits
+struct SyncRef
+{
+	int m_id;					// compound id of the primitive
+	struct SyncRef* m_next;
+};
+typedef struct SyncRef SyncRef;
+
+int syncRefAdd(SyncRef** list, int id);
+int syncRefRemove(SyncRef** list, int id);
+SyncRef* syncRefPop(SyncRef** list);
+void syncRefFree(SyncRef** list);
+
+// Marks a primitive as having no owner. Used for primitives still in use when their owner exits
+void orphanSyncObject(int id);
+
+// Returns the user count of a primitive, or NULL if it does not exist (anymore)
+int* getSyncUsers(int id);
+
+// Gives a forked child a reference to every primitive its parent created or inherited
+void syncShareWithChild(PCB* parent, PCB* child);
+
+// Drops one user of a primitive and returns how many are left, 0 if the primitive is gone
+int dropSyncUser(int id);
+
 // A lock is a mutex that is provided to enable basic synchronization among processes.
 struct Lock
 {
 	int m_id;			// the unique identified for the lock
 	int m_owner;		// the owner process of a lock
+	int m_users;		// live processes holding a reference: the owner and the children forked since
 	int m_state;		// the state of the lock - can be locked/unlocked
 };
 typedef struct Lock Lock;
@@ -59,19 +91,52 @@ struct CVar
 {
 	int m_id;			// the unique identifier for a condition variable.
 	int m_owner;		// the owner process id of a condition variable
+	int m_users;		// live processes holding a reference: the owner and the children forked since
     int m_lockId;		// the lock id associated with the condition variable
 };
 typedef struct CVar CVar;
 
+// The pipe buffer is used as a ring: valid contents start at m_head and wrap around the end of
+// the buffer, so reads and writes only touch the bytes they move
 struct Pipe
 {
 	int m_id;			// the unique identifier for a pipe
-	void* m_buffer;		// the buffer where the pipe's contents are stored
+	int m_owner;		// the owner process of a pipe
+	int m_users;		// live processes holding a reference: the owner and the children forked since
+	void* m_buffer;		// the buffer where the pipe's contents are stored, NULL for page backed pipes
+	unsigned int* m_frames;	// the frames holding the contents of a page backed pipe
+	int m_numFrames;	// the number of entries in m_frames
+	int m_size;			// the capacity of the pipe in bytes
+	int m_head;			// the offset of the oldest unread byte in m_buffer
 	int m_wLength;		// the length of the pipe contents that is valid after written to
 };
 
 typedef struct Pipe Pipe;
 
+// A reader-writer lock lets any number of readers hold it at the same time, or exactly one writer.
+// Waiting writers are preferred over new readers so that a steady stream of readers cannot starve them.
+struct RWLock
+{
+	int m_id;			// the unique identifier for the reader-writer lock
+	int m_owner;		// the owner process of the reader-writer lock
+	int m_users;		// live processes holding a reference: the owner and the children forked since
+	int m_readers;		// the number of readers currently holding the lock
+	int m_writer;		// the pid of the writer holding the lock, -1 if no writer holds it
+};
+typedef struct RWLock RWLock;
+
+// A barrier blocks processes until m_count of them have arrived, then releases all of them at once.
+// It resets itself afterwards so that the same barrier can separate consecutive phases
+struct Barrier
+{
+	int m_id;			// the unique identifier for the barrier
+	int m_owner;		// the owner process of the barrier
+	int m_users;		// live processes holding a reference: the owner and the children forked since
+	int m_count;		// the number of processes that have to arrive before anyone leaves
+	int m_arrived;		// the number of processes waiting in the current phase
+};
+typedef struct Barrier Barrier;
+
 // Since the synchronization primitives are all facilities provided by the kernel to
 // userland processes, we are completely free to control the global list of all locks, cvars, pipes
 // that are opened and closed in a sequential but safe manner
@@ -90,6 +155,7 @@ struct LockQueueNode
 {
 	struct Lock* m_lock;				// a pointer to the lock that is under consideration
 	int m_holder;                       // the pid of the process that holds the lock
+	PCB* m_holderPcb;                   // the pcb of the holder, NULL while the lock is free
 	PCBQueue* m_waitingQueue;	// a pointer to the waiting list of processes to have the lock
 	struct LockQueueNode* m_next;		// a pointer to the next lock that is being used within the OS
 };
@@ -104,6 +170,66 @@ int removeLockNode(LockQueueNode* lockNode);
 int createLock(int pid);
 int freeLock(LockQueueNode* lockNode); // to be implemented when we write kernelReclaim
 
+// Priority inheritance
+#define MAX_DONATION_DEPTH 8    // how many nested locks a donation is followed through
+
+// Lends the priority of waiter to the holder of lockNode, and on through the locks that holder waits on
+void donatePriority(PCB* waiter, LockQueueNode* lockNode);
+
+// Recomputes the effective priority of pcb from its base priority and the waiters of the locks it holds
+void refreshPriority(PCB* pcb);
+
+// Undoes a donation after a waiter left lockNode: refreshes its holder and every holder down the
+// chain donatePriority followed
+void withdrawPriority(LockQueueNode* lockNode);
+
+
+// Reader-writer locks
+struct RWLockQueue
+{
+	struct RWLockQueueNode* m_head;
+	struct RWLockQueueNode* m_tail;
+};
+typedef struct RWLockQueue RWLockQueue;
+
+struct RWLockQueueNode
+{
+	struct RWLock* m_rwlock;			// a pointer to the reader-writer lock under consideration
+	PCBQueue* m_readWaitingQueue;		// processes waiting to acquire the lock for reading
+	PCBQueue* m_writeWaitingQueue;		// processes waiting to acquire the lock for writing
+	struct RWLockQueueNode* m_next;		// a pointer to the next reader-writer lock used within the OS
+};
+typedef struct RWLockQueueNode RWLockQueueNode;
+
+// Reader-writer lock functions
+void rwlockNodeEnqueue(RWLockQueueNode* rwlockQueueNode);
+RWLockQueueNode* getRWLockNode(int rwlockId);
+int removeRWLockNode(RWLockQueueNode* rwlockNode);
+int createRWLock(int pid);
+int freeRWLock(RWLockQueueNode* rwlockNode);
+
+// Barriers
+struct BarrierQueue
+{
+	struct BarrierQueueNode* m_head;
+	struct BarrierQueueNode* m_tail;
+};
+typedef struct BarrierQueue BarrierQueue;
+
+struct BarrierQueueNode
+{
+	struct Barrier* m_barrier;			// a pointer to the barrier under consideration
+	PCBQueue* m_waitingQueue;			// processes that arrived in the current phase
+	struct BarrierQueueNode* m_next;	// a pointer to the next barrier used within the OS
+};
+typedef struct BarrierQueueNode BarrierQueueNode;
+
+// Barrier functions
+void barrierNodeEnqueue(BarrierQueueNode* barrierQueueNode);
+BarrierQueueNode* getBarrierNode(int barrierId);
+int removeBarrierNode(BarrierQueueNode* barrierNode);
+int createBarrier(int pid, int count);
+int freeBarrier(BarrierQueueNode* barrierNode);
 
 // Condition variables
 struct CVarQueue
@@ -134,47 +260,46 @@ int freeCVar(CVarQueueNode* cvarNode);
 struct PipeQueueNode
 {
 	Pipe* m_pipe;
+	PCBQueue* m_readWaitingQueue;		// readers waiting for data in the pipe, in arrival order
+	PCBQueue* m_writeWaitingQueue;		// writers waiting for space in the pipe
+	PollWaiter* m_pollers;				// processes polling the pipe
 	struct PipeQueueNode* m_next;
 };
 
-struct PipeReadWaitQueueNode
-{
-	PCB* m_pcb;
-	int m_id;
-	int m_len;
-	void* m_buf;
-	struct PipeReadWaitQueueNode* m_next;
-};
-
 struct PipeQueue
 {
 	struct PipeQueueNode* m_head;
 	struct PipeQueueNode* m_tail;
 };
 
-struct PipeReadWaitQueue
-{
-	struct PipeReadWaitQueueNode* m_head;
-	struct PipeReadWaitQueueNode* m_tail;
-};
-
 typedef struct PipeQueueNode PipeQueueNode;
-typedef struct PipeReadWaitQueueNode PipeReadWaitQueueNode;
 typedef struct PipeQueue PipeQueue;
-typedef struct PipeReadWaitQueue PipeReadWaitQueue;
 
-int pipeEnqueue(int id);
-int pipeReadWaitEnqueue(int id, int m_len, PCB* pcb, void* buff);
-PipeReadWaitQueueNode* removePipeReadWaitNode(int id, PCB* pcb);
+// pipes larger than PIPE_BUFFER_LEN are backed by whole frames instead of the kernel heap
+#define PIPE_MAX_PAGES			16		// the largest page backed pipe
+#define PIPE_PROCESS_PAGE_LIMIT	32		// the frames all the pipes owned by one process may use
+
+int pipeEnqueue(int id, int pid, int size);
+int getPipeFramesOwnedBy(PCB* pcb);
+int allocPipeFrames(Pipe* pipe, int size);
+void freePipeFrames(Pipe* pipe);
+void pipeTransfer(Pipe* pipe, int offset, char* buf, int len, int toPipe);
+int pipeUnshareFrames(Pipe* pipe, int offset, int len);
+int getRemappableR1Page(PCB* pcb, unsigned int addr);
+int pipeSharePagesIn(Pipe* pipe, PCB* pcb, void* buf, int len);
+int pipeMapPagesOut(Pipe* pipe, PCB* pcb, void* buf, int len);
 PipeQueueNode* getPipeNode(int pipeId);
-void processPendingPipeReadRequests(int pipe_id, int currlen);
+void wakePipeReaders(PipeQueueNode* pipeNode);
 int removePipeNode(PipeQueueNode* pipeNode);
 int freePipe(PipeQueueNode* pipeNode);
+void pipeCopyIn(Pipe* pipe, void* buf, int len);
+void pipeCopyOut(Pipe* pipe, void* buf, int len);
 
 // Globally defined pipes
 extern LockQueue gLockQueue;			// the global lock queue
 extern CVarQueue gCVarQueue;			// the global cvar queue
+extern RWLockQueue gRWLockQueue;		// the global reader-writer lock queue
+extern BarrierQueue gBarrierQueue;		// the global barrier queue
 extern PipeQueue gPipeQueue;					// global queue for pipes
-extern PipeReadWaitQueue gPipeReadWaitQueue;	// global queue for processes waiting on pipes
 
 #endif
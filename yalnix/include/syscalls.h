@@ -1,6 +1,8 @@
 #ifndef __SYSCALLS_H__
 #define __SYSCALLS_H__
 
+#include <yalnix.h>
+
 // Kernel implementations of syscalls
 
 extern int kernelFork(void);
@@ -10,19 +12,46 @@ extern int kernelWait(int *status_ptr, UserContext* ctx);
 extern int kernelGetPid(void);
 extern int kernelBrk(void *addr);
 extern int kernelDelay(int clock_ticks, UserContext* ctx);
-extern int kernelTtyRead(int tty_id, void *buf, int len, UserContext* ctx);
-extern int kernelTtyWrite(int tty_id, void *buf, int len, UserContext* ctx);
+extern int kernelTtyRead(int tty_id, void *buf, int len, int nonblock, UserContext* ctx);
+extern int kernelTtyWrite(int tty_id, void *buf, int len, int nonblock, UserContext* ctx);
+extern int kernelTtyWritePinned(int tty_id, void *buf, int len, UserContext* ctx);
+extern int kernelTtyWriteAsync(int tty_id, void *buf, int len);
+extern int kernelTtyWaitTicket(int tty_id, int ticket, UserContext* ctx);
+extern int kernelTtyStats(int tty_id, TtyStats* stats);
 extern int kernelPipeInit(int *pipe_idp);
-extern int kernelPipeRead(int pipe_id, void *buf, int len);
-extern int kernelPipeWrite(int pipe_id, void *buf, int len);
+extern int kernelPipeInitEx(int *pipe_idp, int size);
+extern int pollCheck(PollEntry* entries, int n);
+extern int pollRegister(PollEntry* entries, int n, PCB* pcb, int add);
+extern int kernelPoll(PollEntry* entries, int n, int timeout, UserContext* ctx);
+extern int kernelPipeRead(int pipe_id, void *buf, int len, int exact, UserContext* ctx);
+extern int kernelPipeWrite(int pipe_id, void *buf, int len, UserContext* ctx);
 extern int kernelLockInit(int *lock_idp);
 extern int kernelAcquire(int lock_id, UserContext* ctx);
+extern int kernelAcquireTimeout(int lock_id, int ticks, UserContext* ctx);
 extern int kernelRelease(int lock_id);
+extern int kernelSetPriority(int priority);
 extern int kernelCvarInit(int *cvar_idp);
 extern int kernelCvarSignal(int cvar_id);
 extern int kernelCvarBroadcast(int cvar_id);
 extern int kernelCvarWait(int cvar_id, int lock_id, UserContext* ctx);
+extern int kernelCvarTimedWait(int cvar_id, int lock_id, int ticks, UserContext* ctx);
+extern int kernelRWLockInit(int *rwlock_idp);
+extern int kernelReadAcquire(int rwlock_id, UserContext* ctx);
+extern int kernelWriteAcquire(int rwlock_id, UserContext* ctx);
+extern int kernelRWRelease(int rwlock_id);
+extern int kernelBarrierInit(int *barrier_idp, int count);
+extern int kernelBarrierWait(int barrier_id, UserContext* ctx);
 extern int kernelReclaim(int id);
+extern int freeSyncObject(int id);
+extern void releaseHeldLocks(PCB* pcb);
+extern void reclaimOwnedSyncs(PCB* pcb);
 extern int kernelPS(int tty_id, UserContext* ctx);
+extern int kernelRegister(unsigned int index);
+extern int kernelSend(void* msg, int pid, UserContext* ctx);
+extern int kernelReceive(void* msg, int pid, UserContext* ctx);
+extern int kernelReply(void* msg, int pid, UserContext* ctx);
+extern int kernelCopyFrom(int pid, void* dest, void* src, int len);
+extern int kernelCopyTo(int pid, void* dest, void* src, int len);
+extern void ipcCleanup(PCB* pcb);
 
 #endif
@@ -24,24 +24,116 @@ struct TerminalRequest
 {
     TermReqCode m_code;
     PCB* m_pcb;                         // the pcb of the process that initiated this request
-    void* m_bufferR0;                   // the location in R0 where data is stored as its received or sent
-    void* m_bufferR1;                   // the region1 buffer location - valid only for read requests - we need to store the location where we have to write back data once we receive data from the terminal
+    void* m_bufferR0;                   // the pool's staging buffer for this request. owned by the pool, never freed
+    void* m_bufferR1;                   // the caller's region1 buffer. owned by the caller, never freed by the kernel
     int m_len;                          // the size of the read or write request
     int m_serviced;                     // the amount of data that has been sent or read so far.
     int m_remaining;                    // redundant but convenient check to keep track of how much data is to processed = m_len - m_serviced
     int m_requestInitiated;             // we will use this field to tell the kernel if there has been a request that has already been started. this field is valid only within the head
+    int m_ticket;                       // the ticket an asynchronous write was given
+    unsigned int m_endPos;              // for an async write that is all in the ring, the output position of its last byte
     struct TerminalRequest* m_next;     // store the next request as a linked list
 };
 
 typedef struct TerminalRequest TerminalRequest;
 
-// We have NUM_TERMINALS queues of requests
-// Head nodes to the queues for the write and read requests
+#define TERM_MAX_REQUESTS   8       // asynchronous writes a terminal keeps at once
+
+// Every terminal request comes from its terminal's pool, along with a staging buffer for the
+// bytes it holds, so terminal I/O never touches the heap. Free requests are linked through m_next
+struct TerminalRequestPool
+{
+    TerminalRequest m_requests[TERM_MAX_REQUESTS];
+    char m_buffers[TERM_MAX_REQUESTS][TERMINAL_MAX_LINE];
+    TerminalRequest* m_free;
+};
+
+typedef struct TerminalRequestPool TerminalRequestPool;
+
+#define TERM_INPUT_LEN      (4 * TERMINAL_MAX_LINE)     // bytes of received input kept per terminal
+
+// Every receive interrupt appends the new line here, whether or not anybody is reading.
+// TtyRead takes its bytes from the front
+struct TerminalInput
+{
+    char m_buffer[TERM_INPUT_LEN];
+    int m_len;
+    unsigned int m_received;            // bytes that ever came in, dropped ones included
+    int m_receives;                     // receive interrupts
+    int m_lastReceive;                  // the clock tick of the last receive interrupt
+};
+
+typedef struct TerminalInput TerminalInput;
+
+#define TERM_OUTPUT_LEN     (4 * TERMINAL_MAX_LINE)     // bytes of write-behind buffering per terminal
+
+// Output accepted by TtyWrite that has not been transmitted yet. The transmit interrupt
+// keeps draining it, so writers only wait when the ring is full
+struct TerminalOutput
+{
+    char m_ring[TERM_OUTPUT_LEN];
+    int m_head;                         // the oldest byte that has not been transmitted
+    int m_len;                          // bytes in the ring, including the ones in flight
+    int m_inFlight;                     // bytes handed to TtyTransmit and not acknowledged yet
+    char m_staging[TERMINAL_MAX_LINE];  // a chunk that wraps around the end of the ring, or the pinned chunk in flight
+    PCB* m_writer;                      // the writer whose turn it is: a pinned write till it is all out,
+                                        // or a woken writer that has not run yet
+    TerminalRequest* m_pinned;          // a write too long for the ring, sent straight from the blocked writer's pages
+    TerminalRequest m_pinnedReq;        // what m_pinned points to. there is only ever one pinned write per terminal
+    int m_inFlightPinned;               // set when the bytes in flight came from m_pinned rather than the ring
+    unsigned int m_accepted;            // bytes that ever went into the ring
+    unsigned int m_sent;                // bytes that ever were acknowledged by the transmit interrupt
+    int m_transmits;                    // transmit interrupts
+    int m_nextTicket;                   // the ticket the next asynchronous write gets
+};
+
+typedef struct TerminalOutput TerminalOutput;
+
+// Head nodes to the queues of asynchronous write requests. A request stays queued till its last
+// byte has been transmitted, which is what waiting on its ticket waits for
 extern TerminalRequest gTermWReqHeads[NUM_TERMINALS];
-extern TerminalRequest gTermRReqHeads[NUM_TERMINALS];
+extern TerminalRequestPool gTermRequestPool[NUM_TERMINALS];
+extern TerminalInput gTermInput[NUM_TERMINALS];
+extern TerminalOutput gTermOutput[NUM_TERMINALS];
+extern PollWaiter* gTermPollers[NUM_TERMINALS];         // processes polling each terminal
+
+// links every request of the terminal's pool into its free list and gives each its staging buffer
+void initTerminalRequestPool(int tty_id);
+
+// takes a cleared request from the terminal's pool. returns NULL if all of them are in use
+TerminalRequest* getTerminalRequest(int tty_id);
 
-// removes a  request from the queues
+// returns a request that is off the queues to its terminal's pool
 // returns 0 on success, -1 on error
-int removeTerminalRequest(TerminalRequest* req);
+int removeTerminalRequest(int tty_id, TerminalRequest* req);
+
+// copies as much of buf as fits into the output ring. returns the number of bytes taken
+int termOutputAppend(int tty_id, char* buf, int len);
+
+// starts transmitting the next chunk of the ring, or of the pinned write once the ring is empty,
+// unless a transmit is already in flight
+void termStartTransmit(int tty_id);
+
+// called from the transmit interrupt. drops the acknowledged bytes and starts the next chunk.
+// a pinned writer is made ready once all of its bytes are out
+void termTransmitDone(int tty_id);
+
+// hands the terminal to the next writer in line once the ring has room for it
+void termWakeWriter(int tty_id);
+
+// true while asynchronous writes still have bytes that are not in the ring. they go before any new writer
+bool termRequestsPending(int tty_id);
+
+// moves queued asynchronous writes into the ring, in order, as far as there is room
+void termFillFromRequests(int tty_id);
+
+// frees the asynchronous writes that have been transmitted. returns the number freed
+int termReapRequests(int tty_id);
+
+// called from the receive interrupt. appends the received line to the input buffer
+void termReceive(int tty_id);
+
+// makes the first blocked reader ready to run if there is input for it
+void termWakeReader(int tty_id);
 
 #endif
@@ -125,6 +125,13 @@
 
 #define KILL                (-2)
 
+#define TIMEOUT             (-3)    // a timed wait expired before the lock/cvar was obtained.
+                                    // ticks <= 0 never waits: AcquireTimeout is a trylock that returns TIMEOUT
+                                    // if the lock is held, CvarTimedWait releases and reacquires the lock and
+                                    // returns TIMEOUT
+
+#define WOULDBLOCK          (-4)    // a nonblocking call could not finish without waiting
+
 #define SUCCESS             (0)
 
 #define PIPE_BUFFER_LEN     256
@@ -205,12 +212,115 @@ extern int Custom2 _PARAMS((int,int,int,int));
 // custom syscall
 #define PS(tty_id) (Custom0(tty_id,0,0,0))
 
+// custom synchronization syscalls share Custom1.
+// the first argument selects the call, the remaining three are its arguments
+#define CUSTOM_RWLOCK_INIT      0x01
+#define CUSTOM_READ_ACQUIRE     0x02
+#define CUSTOM_WRITE_ACQUIRE    0x03
+#define CUSTOM_RW_RELEASE       0x04
+#define CUSTOM_ACQUIRE_TIMEOUT  0x05
+#define CUSTOM_CVAR_TIMED_WAIT  0x06
+#define CUSTOM_SET_PRIORITY     0x07
+#define CUSTOM_BARRIER_INIT     0x08
+#define CUSTOM_BARRIER_WAIT     0x09
+#define CUSTOM_PIPE_INIT_EX     0x0A
+#define CUSTOM_PIPE_READ_EXACT  0x0B
+#define CUSTOM_POLL             0x0C
+
+#define RWLockInit(rwlock_idp)  (Custom1(CUSTOM_RWLOCK_INIT,(int)(rwlock_idp),0,0))
+#define ReadAcquire(rwlock_id)  (Custom1(CUSTOM_READ_ACQUIRE,rwlock_id,0,0))
+#define WriteAcquire(rwlock_id) (Custom1(CUSTOM_WRITE_ACQUIRE,rwlock_id,0,0))
+#define RWRelease(rwlock_id)    (Custom1(CUSTOM_RW_RELEASE,rwlock_id,0,0))
+
+// timed variants return TIMEOUT if the wait did not finish within the given clock ticks
+#define AcquireTimeout(lock_id,ticks)           (Custom1(CUSTOM_ACQUIRE_TIMEOUT,lock_id,ticks,0))
+#define CvarTimedWait(cvar_id,lock_id,ticks)    (Custom1(CUSTOM_CVAR_TIMED_WAIT,cvar_id,lock_id,ticks))
+
+// priorities range from 0 (default) to 31, higher runs first
+#define SetPriority(priority)   (Custom1(CUSTOM_SET_PRIORITY,priority,0,0))
+
+// a barrier releases its waiters once count processes have arrived
+#define BarrierInit(barrier_idp,count)  (Custom1(CUSTOM_BARRIER_INIT,(int)(barrier_idp),count,0))
+#define BarrierWait(barrier_id)         (Custom1(CUSTOM_BARRIER_WAIT,barrier_id,0,0))
+
+// a pipe holding up to size bytes. large pipes are backed by whole pages
+#define PipeInitEx(pipe_idp,size)       (Custom1(CUSTOM_PIPE_INIT_EX,(int)(pipe_idp),size,0))
+
+// PipeRead returns whatever is in the pipe once it is not empty. this one waits for all len bytes,
+// taking them out as they come in
+#define PipeReadExact(pipe_id,buf,len)  (Custom1(CUSTOM_PIPE_READ_EXACT,pipe_id,(int)(buf),len))
+
+// Poll waits till at least one of the pipes or terminals in entries is ready, or timeout clock ticks pass.
+// A negative timeout waits forever, 0 just checks. Returns the number of entries with m_revents set
+#define YPOLL_IN                0x1     // a pipe has data or a terminal has a line to read
+#define YPOLL_OUT               0x2     // a pipe has space or a terminal is not busy writing
+#define YPOLL_ERR               0x4     // the id is neither a pipe nor a terminal
+#define MAX_POLL_ENTRIES        16
+
+struct PollEntry
+{
+    int m_id;                           // a pipe id or a terminal number
+    int m_events;                       // the events we are interested in
+    int m_revents;                      // the events that are ready, filled in by Poll
+};
+typedef struct PollEntry PollEntry;
+
+#define Poll(entries,n,timeout)         (Custom1(CUSTOM_POLL,(int)(entries),n,timeout))
+
+// nonblocking and asynchronous terminal calls share Custom2. regs[0] selects the call
+#define CUSTOM_TTY_READ_NB      0x01
+#define CUSTOM_TTY_WRITE_NB     0x02
+#define CUSTOM_TTY_WRITE_ASYNC  0x03
+#define CUSTOM_TTY_WAIT         0x04
+#define CUSTOM_TTY_STATS        0x05
+
+// like TtyRead and TtyWrite, but return WOULDBLOCK instead of waiting. a nonblocking write that fits the terminal's
+// output buffer goes in whole or not at all. a longer one takes as much as fits and returns that byte count
+#define TtyReadNonblock(tty_id,buf,len)     (Custom2(CUSTOM_TTY_READ_NB,tty_id,(int)(buf),len))
+#define TtyWriteNonblock(tty_id,buf,len)    (Custom2(CUSTOM_TTY_WRITE_NB,tty_id,(int)(buf),len))
+
+// starts a write of at most TERMINAL_MAX_LINE bytes and returns a ticket right away, or WOULDBLOCK if too many
+// writes are still outstanding on the terminal. TtyWaitTicket blocks till that write has been transmitted
+#define TtyWriteAsync(tty_id,buf,len)       (Custom2(CUSTOM_TTY_WRITE_ASYNC,tty_id,(int)(buf),len))
+#define TtyWaitTicket(tty_id,ticket)        (Custom2(CUSTOM_TTY_WAIT,tty_id,ticket,0))
+
+// kernel counters of a terminal, for measuring how fast it goes. all times are in clock ticks
+struct TtyStats
+{
+    int m_ticks;                        // clock ticks since boot
+    int m_lastReceive;                  // the tick of the most recent receive interrupt
+    unsigned int m_received;            // bytes ever received
+    unsigned int m_sent;                // bytes ever transmitted
+    int m_receives;                     // receive interrupts
+    int m_transmits;                    // transmit interrupts
+};
+typedef struct TtyStats TtyStats;
+
+#define TtyGetStats(tty_id,statsp)          (Custom2(CUSTOM_TTY_STATS,tty_id,(int)(statsp),0))
+
 /*
  * A Yalnix library function: TtyPrintf(num, format, args) works like
  * printf(format, args) on terminal num.
  */
 extern int TtyPrintf _PARAMS((int, char *, ...));
 
+/*
+ * TtyPrintf goes through a buffered output stream per terminal.
+ * Line buffered streams (the default) are written out at every
+ * newline, fully buffered ones when TTY_STREAM_LEN bytes are
+ * pending.  TtyFlush writes out what is pending (all terminals for
+ * a negative tty_id); exit and TtyRead of the same terminal flush
+ * too.  TtyWrite itself is never buffered.
+ */
+#define TTY_BUFFER_LINE		0
+#define TTY_BUFFER_FULL		1
+#define TTY_BUFFER_NONE		2
+#define TTY_STREAM_LEN		1024	/* one TERMINAL_MAX_LINE */
+
+extern int TtySetBuffering _PARAMS((int, int));
+extern int TtyStreamWrite _PARAMS((int, void *, int));
+extern int TtyFlush _PARAMS((int));
+
 #ifdef __cplusplus
 }
 #endif
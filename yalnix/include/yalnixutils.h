@@ -36,4 +36,32 @@ void setR1PageTableAlone(PCB* process);
 
 int checkValidAddress(unsigned int addr, PCB* pcb);
 
+// maps the physical frame pfn into the kernel window page and returns the address it can be reached at
+void* mapKernelWindow(unsigned int page, unsigned int pfn);
+
+// invalidates the kernel window mapping
+void unmapKernelWindow(unsigned int page);
+
+// adds one more mapping to a frame
+void shareFrame(unsigned int pfn);
+
+// drops one mapping of a frame and frees it once nobody maps it anymore
+void releaseFrame(unsigned int pfn);
+
+// copies the contents of the frame into a fresh frame. returns the new frame or ERROR
+int copyFrame(unsigned int pfn);
+
+// gives the process a private writable copy of the R1 page. returns ERROR if we are out of frames
+int breakCopyOnWrite(PCB* pcb, int r1page);
+
+// makes sure the kernel can write to [addr, addr + len) in the process's R1 space
+int resolveCopyOnWrite(PCB* pcb, unsigned int addr, int len);
+
+// checks that [addr, addr + len) is mapped in the process's R1 space, and writable (or copy on write) if write is set
+int checkProcessRange(PCB* pcb, unsigned int addr, int len, int write);
+
+// copies len bytes between buf in the running process and addr in another process's R1 space,
+// mapping the other process's frames one at a time. returns ERROR if its range is not mapped
+int copyProcessMemory(PCB* pcb, unsigned int addr, char* buf, int len, int toProcess);
+
 #endif
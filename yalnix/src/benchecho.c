@@ -0,0 +1,39 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+// Echo round trip latency: echoes lines typed on a terminal and reports the clock ticks from the
+// receive interrupt of each line till its echo has been transmitted.
+// usage: benchecho [tty] [rounds]
+int main(int argc, char** argv)
+{
+    int tty = (argc > 1) ? atoi(argv[1]) : 1;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 16;
+    char line[TERMINAL_MAX_LINE];
+    int total = 0, worst = 0, best = -1;
+    int i;
+
+    for(i = 0; i < rounds; i++)
+    {
+        int len = TtyRead(tty, line, TERMINAL_MAX_LINE);
+        if(len <= 0)
+        {
+            TracePrintf(0, "bench echo: TtyRead returned %d\n", len);
+            exit(-1);
+        }
+
+        // the ticket tells us when the echo is really out, not just buffered
+        int ticket = TtyWriteAsync(tty, line, len);
+        TtyWaitTicket(tty, ticket);
+        TtyStats stats;
+        TtyGetStats(tty, &stats);
+
+        int latency = stats.m_ticks - stats.m_lastReceive;
+        total += latency;
+        if(latency > worst) worst = latency;
+        if(best < 0 || latency < best) best = latency;
+    }
+
+    TracePrintf(0, "bench echo: tty %d rounds %d ticks min %d max %d total %d\n",
+                tty, rounds, best, worst, total);
+    exit(0);
+}
@@ -0,0 +1,36 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+// Line read throughput: reads lines from a terminal and reports how many clock ticks it took
+// from the first receive interrupt till the last line was read.
+// usage: benchread [tty] [lines]
+int main(int argc, char** argv)
+{
+    int tty = (argc > 1) ? atoi(argv[1]) : 1;
+    int lines = (argc > 2) ? atoi(argv[2]) : 64;
+    char line[TERMINAL_MAX_LINE];
+    TtyStats first, last;
+    int bytes = 0;
+    int i;
+
+    for(i = 0; i < lines; i++)
+    {
+        int len = TtyRead(tty, line, TERMINAL_MAX_LINE);
+        if(len <= 0)
+        {
+            TracePrintf(0, "bench read: TtyRead returned %d\n", len);
+            exit(-1);
+        }
+
+        // the clock starts with the first line that came in, not with us
+        if(i == 0) TtyGetStats(tty, &first);
+        bytes += len;
+    }
+    TtyGetStats(tty, &last);
+
+    int ticks = last.m_ticks - first.m_lastReceive;
+    TracePrintf(0, "bench read: tty %d lines %d bytes %d ticks %d receives %d lines/tick %d\n",
+                tty, lines, bytes, ticks, last.m_receives - first.m_receives + 1,
+                ticks > 0 ? lines / ticks : 0);
+    exit(0);
+}
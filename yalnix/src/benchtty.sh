@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Runs the terminal benchmarks and collects their results from the trace files.
+# Every benchmark runs as its own init process on terminal 1 and reports clock ticks
+# from the kernel's terminal counters, so runs before and after a terminal change compare directly.
+#
+# usage: ./benchtty.sh [-i]
+#   -i also runs the echo and line read benchmarks, which wait for lines typed or pasted
+#      into terminal 1
+#
+
+YALNIX="./yalnix -x -lk 0 -lu 1"
+TTY=1
+OUT=bench.results
+
+run()
+{
+    trace=bench.$$.trace
+    $YALNIX -t $trace "$@" > /dev/null 2>&1
+    grep "bench " $trace | sed 's/^.*bench /bench /' | tee -a $OUT
+    rm -f $trace
+}
+
+make benchwrite benchwriters benchecho benchread yalnix > /dev/null || exit 1
+: > $OUT
+
+# single writer bulk output, from chunks that fit the output ring to ones that are pinned
+for chunk in 64 1024 4096 8192
+do
+    run benchwrite $TTY 65536 $chunk
+done
+
+# concurrent writers sharing the terminal
+for writers in 1 2 4 8
+do
+    run benchwriters $TTY $writers 64
+done
+
+if [ "$1" = "-i" ]
+then
+    echo "type or paste 16 lines into terminal $TTY"
+    run benchecho $TTY 16
+    echo "paste 64 lines into terminal $TTY"
+    run benchread $TTY 64
+fi
+
+echo "results are in $OUT"
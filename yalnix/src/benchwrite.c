@@ -0,0 +1,51 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+// Single writer bulk output: writes total bytes to a terminal in chunks of the given size and
+// reports how many clock ticks it took till the last byte was transmitted.
+// usage: benchwrite [tty] [total] [chunk]
+#define MAX_CHUNK   (8 * TERMINAL_MAX_LINE)
+
+char gBuffer[MAX_CHUNK];
+
+int main(int argc, char** argv)
+{
+    int tty = (argc > 1) ? atoi(argv[1]) : 1;
+    int total = (argc > 2) ? atoi(argv[2]) : 64 * TERMINAL_MAX_LINE;
+    int chunk = (argc > 3) ? atoi(argv[3]) : TERMINAL_MAX_LINE;
+    if(chunk <= 0 || chunk > MAX_CHUNK) chunk = TERMINAL_MAX_LINE;
+
+    // lines of 63 letters so the output is easy to eyeball
+    int i;
+    for(i = 0; i < MAX_CHUNK; i++)
+    {
+        gBuffer[i] = (i % 64 == 63) ? '\n' : (char)('a' + i % 26);
+    }
+
+    TtyStats before, after;
+    TtyGetStats(tty, &before);
+    int written = 0;
+    while(written < total)
+    {
+        int len = total - written;
+        if(len > chunk) len = chunk;
+        int rc = TtyWrite(tty, gBuffer, len);
+        if(rc != len)
+        {
+            TracePrintf(0, "bench write: TtyWrite returned %d for %d bytes\n", rc, len);
+            exit(-1);
+        }
+        written += len;
+    }
+
+    // writes go out in order, so once this one is out everything before it is too
+    int ticket = TtyWriteAsync(tty, "\n", 1);
+    TtyWaitTicket(tty, ticket);
+    TtyGetStats(tty, &after);
+
+    int ticks = after.m_ticks - before.m_ticks;
+    TracePrintf(0, "bench write: tty %d bytes %d chunk %d ticks %d transmits %d bytes/tick %d\n",
+                tty, written, chunk, ticks, after.m_transmits - before.m_transmits,
+                ticks > 0 ? (int)(after.m_sent - before.m_sent) / ticks : 0);
+    exit(0);
+}
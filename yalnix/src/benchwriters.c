@@ -0,0 +1,55 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+// N concurrent writers: forks writers that each write lines to the same terminal and reports how
+// many clock ticks it took till all of their output was transmitted.
+// usage: benchwriters [tty] [writers] [lines]
+#define MAX_WRITERS 16
+#define LINE_LEN    64
+
+int main(int argc, char** argv)
+{
+    int tty = (argc > 1) ? atoi(argv[1]) : 1;
+    int writers = (argc > 2) ? atoi(argv[2]) : 4;
+    int lines = (argc > 3) ? atoi(argv[3]) : 64;
+    if(writers <= 0 || writers > MAX_WRITERS) writers = 4;
+
+    TtyStats before, after;
+    TtyGetStats(tty, &before);
+    int i;
+    for(i = 0; i < writers; i++)
+    {
+        if(Fork() == 0)
+        {
+            // every line carries the writer's letter, so interleaving would show
+            char line[LINE_LEN];
+            int j;
+            for(j = 0; j < LINE_LEN - 1; j++)
+            {
+                line[j] = (char)('A' + i);
+            }
+            line[LINE_LEN - 1] = '\n';
+            for(j = 0; j < lines; j++)
+            {
+                TtyWrite(tty, line, LINE_LEN);
+            }
+            exit(0);
+        }
+    }
+
+    int status;
+    for(i = 0; i < writers; i++)
+    {
+        Wait(&status);
+    }
+    int ticket = TtyWriteAsync(tty, "\n", 1);
+    TtyWaitTicket(tty, ticket);
+    TtyGetStats(tty, &after);
+
+    int ticks = after.m_ticks - before.m_ticks;
+    TracePrintf(0, "bench writers: tty %d writers %d bytes %d ticks %d transmits %d bytes/tick %d\n",
+                tty, writers, (int)(after.m_sent - before.m_sent), ticks,
+                after.m_transmits - before.m_transmits,
+                ticks > 0 ? (int)(after.m_sent - before.m_sent) / ticks : 0);
+    exit(0);
+}
@@ -114,13 +114,9 @@ void interruptKernel(UserContext* ctx)
 				}
 				else
 				{
-					// The current process will go inside and do a context switch
-					// it will be repeatedly context switched till it either completes correctly
-					// or fails. It will come out of this function and continue executing into userland
-					int read = kernelTtyRead(tty_id, buf, len, ctx);
-					if(read == len)
-						ctx->regs[0] = len;
-					else ctx->regs[0] = ERROR;
+					// The current process blocks inside till some input has arrived and comes out
+					// with up to len bytes of the next line
+					ctx->regs[0] = kernelTtyRead(tty_id, buf, len, 0, ctx);
 				}
 			}
 		break;
@@ -148,7 +144,7 @@ void interruptKernel(UserContext* ctx)
 					// The current process will go inside and do a context switch
 					// it will be repeatedly context switched till it either completes correctly
 					// or fails. It will come out of this function and continue executing into userland
-					int written = kernelTtyWrite(tty_id, buf, len, ctx);
+					int written = kernelTtyWrite(tty_id, buf, len, 0, ctx);
 					if(written == len)
 						ctx->regs[0] = len;
 					else ctx->regs[0] = ERROR;
@@ -217,7 +213,7 @@ void interruptKernel(UserContext* ctx)
 				int pipe_id = (int)ctx->regs[0];
 				void* buff = (void*)ctx->regs[1];
 				int len = (int)ctx->regs[2];
-				int rc = kernelPipeRead(pipe_id, buff, len);
+				int rc = kernelPipeRead(pipe_id, buff, len, 0, ctx);
 				memcpy(ctx, currpcb->m_uctx, sizeof(UserContext));
 				ctx->regs[0] = rc;
 				return;
@@ -230,8 +226,7 @@ void interruptKernel(UserContext* ctx)
 				int pipe_id = (int)ctx->regs[0];
 				void* buff = (void*)ctx->regs[1];
 				int len = (int)ctx->regs[2];
-				if(len > PIPE_BUFFER_LEN) { TracePrintf(MODERATE, "ERROR: Writing to a pipe with length greater than its size\n"); ctx->regs[0] = ERROR; return; }
-				int rc = kernelPipeWrite(pipe_id, buff, len);
+				int rc = kernelPipeWrite(pipe_id, buff, len, ctx);
 				memcpy(ctx, currpcb->m_uctx, sizeof(UserContext));
 				ctx->regs[0] = rc;
 				return;
@@ -252,6 +247,227 @@ void interruptKernel(UserContext* ctx)
 				return;
 			}
 		break;
+		case YALNIX_CUSTOM_1:
+			{
+				// custom synchronization calls. regs[0] selects the call
+				int op = ctx->regs[0];
+				switch(op)
+				{
+					case CUSTOM_RWLOCK_INIT:
+						{
+							int* rwlock_idp = (int*)ctx->regs[1];
+							ctx->regs[0] = kernelRWLockInit(rwlock_idp);
+						}
+					break;
+					case CUSTOM_READ_ACQUIRE:
+						{
+							int rwlock_id = ctx->regs[1];
+							ctx->regs[0] = kernelReadAcquire(rwlock_id, ctx);
+						}
+					break;
+					case CUSTOM_WRITE_ACQUIRE:
+						{
+							int rwlock_id = ctx->regs[1];
+							ctx->regs[0] = kernelWriteAcquire(rwlock_id, ctx);
+						}
+					break;
+					case CUSTOM_RW_RELEASE:
+						{
+							int rwlock_id = ctx->regs[1];
+							ctx->regs[0] = kernelRWRelease(rwlock_id);
+						}
+					break;
+					case CUSTOM_ACQUIRE_TIMEOUT:
+						{
+							int lock_id = ctx->regs[1];
+							int ticks = ctx->regs[2];
+							ctx->regs[0] = kernelAcquireTimeout(lock_id, ticks, ctx);
+						}
+					break;
+					case CUSTOM_CVAR_TIMED_WAIT:
+						{
+							int cvar_id = ctx->regs[1];
+							int lock_id = ctx->regs[2];
+							int ticks = ctx->regs[3];
+							ctx->regs[0] = kernelCvarTimedWait(cvar_id, lock_id, ticks, ctx);
+						}
+					break;
+					case CUSTOM_SET_PRIORITY:
+						{
+							int priority = ctx->regs[1];
+							ctx->regs[0] = kernelSetPriority(priority);
+						}
+					break;
+					case CUSTOM_BARRIER_INIT:
+						{
+							int* barrier_idp = (int*)ctx->regs[1];
+							int count = ctx->regs[2];
+							ctx->regs[0] = kernelBarrierInit(barrier_idp, count);
+						}
+					break;
+					case CUSTOM_BARRIER_WAIT:
+						{
+							int barrier_id = ctx->regs[1];
+							ctx->regs[0] = kernelBarrierWait(barrier_id, ctx);
+						}
+					break;
+					case CUSTOM_PIPE_INIT_EX:
+						{
+							int* pipe_idp = (int*)ctx->regs[1];
+							int size = ctx->regs[2];
+							ctx->regs[0] = kernelPipeInitEx(pipe_idp, size);
+						}
+					break;
+					case CUSTOM_POLL:
+						{
+							PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+							PollEntry* entries = (PollEntry*)ctx->regs[1];
+							int n = ctx->regs[2];
+							int timeout = ctx->regs[3];
+							if(n < 0 || checkProcessRange(currpcb, (unsigned int)entries, n * sizeof(PollEntry), 1) != SUCCESS)
+							{
+								TracePrintf(MODERATE, "ERROR: Invalid poll entries\n");
+								ctx->regs[0] = ERROR;
+							}
+							else
+							{
+								ctx->regs[0] = kernelPoll(entries, n, timeout, ctx);
+							}
+						}
+					break;
+					case CUSTOM_PIPE_READ_EXACT:
+						{
+							int pipe_id = ctx->regs[1];
+							void* buff = (void*)ctx->regs[2];
+							int len = ctx->regs[3];
+							ctx->regs[0] = kernelPipeRead(pipe_id, buff, len, 1, ctx);
+						}
+					break;
+					default:
+						TracePrintf(MODERATE, "ERROR: Unknown custom synchronization call %d\n", op);
+						ctx->regs[0] = ERROR;
+					break;
+				}
+				return;
+			}
+		break;
+		case YALNIX_REGISTER:
+			{
+				unsigned int index = ctx->regs[0];
+				ctx->regs[0] = kernelRegister(index);
+			}
+		break;
+		case YALNIX_SEND:
+			{
+				void* msg = (void*)ctx->regs[0];
+				int pid = ctx->regs[1];
+				ctx->regs[0] = kernelSend(msg, pid, ctx);
+			}
+		break;
+		case YALNIX_RECEIVE:
+			{
+				void* msg = (void*)ctx->regs[0];
+				ctx->regs[0] = kernelReceive(msg, 0, ctx);
+			}
+		break;
+		case YALNIX_RECEIVESPECIFIC:
+			{
+				void* msg = (void*)ctx->regs[0];
+				int pid = ctx->regs[1];
+				ctx->regs[0] = kernelReceive(msg, pid, ctx);
+			}
+		break;
+		case YALNIX_REPLY:
+			{
+				void* msg = (void*)ctx->regs[0];
+				int pid = ctx->regs[1];
+				ctx->regs[0] = kernelReply(msg, pid, ctx);
+			}
+		break;
+		case YALNIX_COPY_FROM:
+			{
+				int pid = ctx->regs[0];
+				void* dest = (void*)ctx->regs[1];
+				void* src = (void*)ctx->regs[2];
+				int len = ctx->regs[3];
+				ctx->regs[0] = kernelCopyFrom(pid, dest, src, len);
+			}
+		break;
+		case YALNIX_COPY_TO:
+			{
+				int pid = ctx->regs[0];
+				void* dest = (void*)ctx->regs[1];
+				void* src = (void*)ctx->regs[2];
+				int len = ctx->regs[3];
+				ctx->regs[0] = kernelCopyTo(pid, dest, src, len);
+			}
+		break;
+		case YALNIX_CUSTOM_2:
+			{
+				// nonblocking and asynchronous terminal calls. regs[0] selects the call
+				PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+				int op = ctx->regs[0];
+				int tty_id = ctx->regs[1];
+				if(tty_id < 0 || tty_id >= NUM_TERMINALS)
+				{
+					TracePrintf(MODERATE, "ERROR: Invalid terminal number\n");
+					ctx->regs[0] = ERROR;
+					return;
+				}
+				switch(op)
+				{
+					case CUSTOM_TTY_READ_NB:
+					case CUSTOM_TTY_WRITE_NB:
+					case CUSTOM_TTY_WRITE_ASYNC:
+						{
+							void* buf = (void*)ctx->regs[2];
+							int len = ctx->regs[3];
+							if(len < 0 || checkValidAddress((unsigned int)buf, currpcb) != 0)
+							{
+								ctx->regs[0] = ERROR;
+							}
+							else if(op == CUSTOM_TTY_READ_NB)
+							{
+								ctx->regs[0] = kernelTtyRead(tty_id, buf, len, 1, ctx);
+							}
+							else if(op == CUSTOM_TTY_WRITE_NB)
+							{
+								ctx->regs[0] = kernelTtyWrite(tty_id, buf, len, 1, ctx);
+							}
+							else
+							{
+								ctx->regs[0] = kernelTtyWriteAsync(tty_id, buf, len);
+							}
+						}
+					break;
+					case CUSTOM_TTY_WAIT:
+						{
+							int ticket = ctx->regs[2];
+							ctx->regs[0] = kernelTtyWaitTicket(tty_id, ticket, ctx);
+						}
+					break;
+					case CUSTOM_TTY_STATS:
+						{
+							TtyStats* stats = (TtyStats*)ctx->regs[2];
+							if(checkValidAddress((unsigned int)stats, currpcb) != 0 ||
+							   checkValidAddress((unsigned int)stats + sizeof(TtyStats) - 1, currpcb) != 0)
+							{
+								ctx->regs[0] = ERROR;
+							}
+							else
+							{
+								ctx->regs[0] = kernelTtyStats(tty_id, stats);
+							}
+						}
+					break;
+					default:
+						TracePrintf(MODERATE, "ERROR: Unknown custom terminal call %d\n", op);
+						ctx->regs[0] = ERROR;
+					break;
+				}
+				return;
+			}
+		break;
 		default:
 			// all others are not implemented syscalls are not implemented.
 		break;
@@ -266,9 +482,10 @@ void interruptClock(UserContext* ctx)
 	// Handle movement of processes from different waiting/running/exited queues
 	// Handle the cleanup of potential swapped out pages
 	TracePrintf(DEBUG, "TRAP_CLOCK\n");
+	gClockTicks++;
 
 	scheduleSleepingProcesses();
-	processPendingPipeReadRequests();
+	scheduleTimedOutProcesses();
 	freeExitedProcesses();			// free the resources associated with exited processes
 
 	// update the quantum of runtime for the current running process
@@ -276,8 +493,10 @@ void interruptClock(UserContext* ctx)
   	currpcb->m_ticks++;
 	if(currpcb->m_ticks > 1)
 	{
-		// schedule logic
-		if(getHeadProcess(&gReadyToRunProcessQ) != NULL)
+		// schedule logic. only round robin among equals and give way to higher priorities,
+		// a lower priority process never takes the cpu from us
+		PCB* bestpcb = getHighestPriorityProcess(&gReadyToRunProcessQ);
+		if(bestpcb != NULL && bestpcb->m_priority >= currpcb->m_priority)
 		{
 			TracePrintf(DEBUG, "We have a process to schedule out\n");
 			// context switch
@@ -309,6 +528,15 @@ void interruptMemory(UserContext* ctx)
 	int code = ctx->code;
 	if(code == YALNIX_ACCERR)
 	{
+		unsigned int addr = (unsigned int)ctx->addr;
+		int r1page = addr / PAGESIZE - gNumPagesR0;
+		if(addr >= VMEM_1_BASE && addr < VMEM_1_LIMIT && currPCB->m_pagetable->m_cow[r1page])
+		{
+			// first write to a page we share with a pipe. give the process its own copy
+			if(breakCopyOnWrite(currPCB, r1page) == SUCCESS) return;
+			TracePrintf(SEVERE, "Out of frames for a copy on write page. Killing the process\n");
+			kernelExit(ERROR, ctx);
+		}
 		TracePrintf(SEVERE, "Memtrap for a page with invalid access permissions. Killing the process\n");
 		kernelExit(ERROR, ctx);
 	}
@@ -379,64 +607,31 @@ void interruptMath(UserContext* ctx)
 }
 
 // Interrupt Handler for terminal recieve
+// The line is always taken into the terminal's input buffer. The first waiting reader is only
+// made ready, the running process keeps the cpu
 void interruptTtyReceive(UserContext* ctx)
 {
 	int tty_id = ctx->code;
-	// put the current running process into ready to run queues
-	PCB* currpcb = getHeadProcess(&gRunningProcessQ);
-
-	processDequeue(&gRunningProcessQ);
-	processEnqueue(&gReadyToRunProcessQ, currpcb);
-
-	memcpy(currpcb->m_uctx, ctx, sizeof(UserContext));
-	// pick the process that was doing a service requests
-	TerminalRequest* head = &gTermRReqHeads[tty_id];
-	TerminalRequest* req = head->m_next;
-	if(req != NULL)
-	{
-		// read the bytes First
-		int read = TtyReceive(tty_id, req->m_bufferR0, TERMINAL_MAX_LINE);
-		req->m_serviced = read;
-		PCB* nextpcb = req->m_pcb;
-		if(nextpcb != NULL)
-		{
-			int rc = KernelContextSwitch(SwitchKCS, currpcb, nextpcb);
-			if(rc == -1)
-			{
-				TracePrintf(SEVERE, "ERROR: context switch failed inside terminal receive interrupt handler\n");
-			}
-		}
-		else
-		{
-			TracePrintf(SEVERE, "ERROR: No pcb to schedule : Inside : TTY_RECEIVE\n");
-		}
-	}
-
-	// THis process which called the terminal process to push text to terminal
-	// wakes up here again. We put ourselves again in running queue
-	processRemove(&gReadyToRunProcessQ, currpcb);
-	processEnqueue(&gRunningProcessQ, currpcb);
-	swapPageTable(currpcb);
-	memcpy(ctx, currpcb->m_uctx, sizeof(UserContext));
+	termReceive(tty_id);
+	termWakeReader(tty_id);
+	wakePollers(gTermPollers[tty_id]);
 	return;
 }
 
 // Interrupt Handler for terminal transmit
+// A chunk of the output ring went out. Start the next one and wake the next writer in line
 void interruptTtyTransmit(UserContext* ctx)
 {
-	// some request was completed.
-	// find that process and put it in ready to run queue
 	int tty_id = ctx->code;
-
-	TerminalRequest* head = &gTermWReqHeads[tty_id];
-	TerminalRequest* req = head->m_next;
-	if(req != NULL)
+	termTransmitDone(tty_id);
+	termFillFromRequests(tty_id);
+	if(termReapRequests(tty_id) > 0)
 	{
-		PCB* pcb = req->m_pcb;
-		processRemove(&gWriteBlockedQ, pcb);
-		processEnqueue(&gReadyToRunProcessQ, pcb);
-		head->m_next = NULL;								// free this guy.!
+		// somebody's ticket may be done
+		processQueueAppend(&gReadyToRunProcessQ, &gTicketWaitQ[tty_id]);
 	}
+	termWakeWriter(tty_id);
+	wakePollers(gTermPollers[tty_id]);
 	return;
 }
 
@@ -4,6 +4,7 @@
 #include <load_info.h>
 #include <pagetable.h>
 #include <process.h>
+#include <scheduler.h>
 #include <terminal.h>
 #include <yalnix.h>
 #include <yalnixutils.h>
@@ -29,6 +30,7 @@ UserProgPageTable* gCurrentR1PageTable = NULL;
 // the global free frame lists
 FrameTableEntry gFreeFramePool;
 FrameTableEntry gUsedFramePool;
+unsigned char* gFrameShareCount = NULL;
 
 unsigned int gNumPagesR0 = VMEM_0_SIZE / PAGESIZE;
 unsigned int gNumPagesR1 = VMEM_1_SIZE / PAGESIZE;
@@ -46,18 +48,29 @@ PCBQueue gReadyToRunProcessQ;
 PCBQueue gWaitProcessQ;
 PCBQueue gTerminatedProcessQ;
 PCBQueue gSleepBlockedQ;
-PCBQueue gReadBlockedQ;
+PCBQueue gReadBlockedQ[NUM_TERMINALS];
+PCBQueue gTicketWaitQ[NUM_TERMINALS];
 PCBQueue gReadFinishedQ;
-PCBQueue gWriteBlockedQ;
 PCBQueue gWriteFinishedQ;
-PCBQueue gWriteWaitQ;
+PCBQueue gWriteWaitQ[NUM_TERMINALS];
 PCBQueue gExitedQ;
+PCBQueue gPollBlockedQ;
+PCBQueue gReceiveBlockedQ;
+PCBQueue gReplyBlockedQ;
+
+PCB* gProcessTable = NULL;
+int gServerTable[MAX_SERVER_INDEX + 1];
 
 // The global synchronization queues
 LockQueue gLockQueue;
 CVarQueue gCVarQueue;
+RWLockQueue gRWLockQueue;
+BarrierQueue gBarrierQueue;
 PipeQueue gPipeQueue;
-PipeReadWaitQueue gPipeReadWaitQueue;
+
+// armed kernel timers for timed waits
+KernelTimer* gKernelTimers = NULL;
+int gClockTicks = 0;
 
 // interrupt vector table
 // we have 7 types of interrupts
@@ -67,7 +80,10 @@ int gVMemEnabled = -1;			// global flag to keep track of the enabling of virtual
 
 // Terminal Requests header nodes
 TerminalRequest gTermWReqHeads[NUM_TERMINALS];
-TerminalRequest gTermRReqHeads[NUM_TERMINALS];
+TerminalRequestPool gTermRequestPool[NUM_TERMINALS];
+TerminalInput gTermInput[NUM_TERMINALS];
+TerminalOutput gTermOutput[NUM_TERMINALS];
+PollWaiter* gTermPollers[NUM_TERMINALS];
 
 int SetKernelBrk(void* addr)
 {
@@ -87,6 +103,12 @@ int SetKernelBrk(void* addr)
 		unsigned int oldBrkAddr = (unsigned int)gKernelBrk;
 		unsigned int oldBrkPg = oldBrkAddr / PAGESIZE;
 		unsigned int newBrkPg = newBrkAddr / PAGESIZE;
+		if(newBrkPg >= KWINDOW_PAGE1)
+		{
+			// the heap would run into the kernel windows and the kernel stack
+			TracePrintf(MODERATE, "Kernel heap cannot grow into the kernel window\n");
+			return -1;
+		}
 		if(newBrkAddr > oldBrkAddr)
 		{
 			// the heap was grown
@@ -333,6 +355,15 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 		}
 	}
 
+	// no frame is shared when we start
+	gFrameShareCount = (unsigned char*)malloc(sizeof(unsigned char) * TOTAL_FRAMES);
+	if(gFrameShareCount == NULL)
+	{
+		TracePrintf(SEVERE, "Unable to allocate memory for the frame share counts\n");
+		exit(-1);
+	}
+	memset(gFrameShareCount, 0, sizeof(unsigned char) * TOTAL_FRAMES);
+
 	// update the heap allocations if any
 	unsigned int NUM_HEAP_FRAMES_IN_USE = (UP_TO_PAGE((unsigned int)gKernelBrk) - dataEndRounded) / PAGESIZE;
 	TracePrintf(DEBUG, "Total Heap Frames : %u\n", NUM_HEAP_FRAMES_IN_USE);
@@ -411,18 +442,25 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 	INIT_QUEUE_HEADS(gReadyToRunProcessQ);
 	INIT_QUEUE_HEADS(gWaitProcessQ);
 	INIT_QUEUE_HEADS(gSleepBlockedQ);
-	INIT_QUEUE_HEADS(gReadBlockedQ);
 	INIT_QUEUE_HEADS(gReadFinishedQ);
-	INIT_QUEUE_HEADS(gWriteBlockedQ);
 	INIT_QUEUE_HEADS(gWriteFinishedQ);
-	INIT_QUEUE_HEADS(gWriteWaitQ);
 	INIT_QUEUE_HEADS(gExitedQ);
+	INIT_QUEUE_HEADS(gPollBlockedQ);
+	INIT_QUEUE_HEADS(gReceiveBlockedQ);
+	INIT_QUEUE_HEADS(gReplyBlockedQ);
+
+	// no servers are registered yet
+	for(i = 0; i <= MAX_SERVER_INDEX; i++)
+	{
+		gServerTable[i] = -1;
+	}
 
 	// create initial synchronization queues
 	INIT_QUEUE_HEADS(gLockQueue);
 	INIT_QUEUE_HEADS(gCVarQueue);
+	INIT_QUEUE_HEADS(gRWLockQueue);
+	INIT_QUEUE_HEADS(gBarrierQueue);
 	INIT_QUEUE_HEADS(gPipeQueue);
-	INIT_QUEUE_HEADS(gPipeReadWaitQueue);
 
 	// Set the page table entries for the kernel in the correct register before enabling VM
 	WriteRegister(REG_PTBR0, (unsigned int)(gKernelPageTable.m_pte));
@@ -441,19 +479,18 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 		gTermWReqHeads[term].m_remaining = 0;
 		gTermWReqHeads[term].m_requestInitiated = 0;
 		gTermWReqHeads[term].m_next = NULL;
+		initTerminalRequestPool(term);
 	}
 
 	for(term = 0; term < NUM_TERMINALS; term++)
 	{
-		gTermRReqHeads[term].m_code = TERM_REQ_NONE;
-		gTermRReqHeads[term].m_pcb = NULL;
-		gTermRReqHeads[term].m_bufferR0 = NULL;
-		gTermRReqHeads[term].m_bufferR1 = NULL;
-		gTermRReqHeads[term].m_len = 0;
-		gTermRReqHeads[term].m_serviced = 0;
-		gTermRReqHeads[term].m_remaining = 0;
-		gTermRReqHeads[term].m_requestInitiated = 0;
-		gTermRReqHeads[term].m_next = NULL;
+		memset(&gTermInput[term], 0, sizeof(TerminalInput));
+		INIT_QUEUE_HEADS(gReadBlockedQ[term]);
+		memset(&gTermOutput[term], 0, sizeof(TerminalOutput));
+		gTermOutput[term].m_nextTicket = 1;
+		INIT_QUEUE_HEADS(gTicketWaitQ[term]);
+		INIT_QUEUE_HEADS(gWriteWaitQ[term]);
+		gTermPollers[term] = NULL;
 	}
 
 	// enable virtual memory
@@ -492,6 +529,7 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 		uctx = NULL;
 		return;
 	}
+	memset(pInitPCB, 0, sizeof(PCB));
 
 	// create a child exit data queue
 	EDQueue* initEDQ = (EDQueue*)malloc(sizeof(EDQueue));
@@ -525,6 +563,7 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 
 	// add init to the running process
 	processEnqueue(&gRunningProcessQ, pInitPCB);
+	processTableAdd(pInitPCB);
 
 	// Set the region1 pagetable entries
 	setR1PageTableAlone(pInitPCB);
@@ -587,6 +626,7 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 		uctx = NULL;
 		return;
 	}
+	memset(pIdlePCB, 0, sizeof(PCB));
 
 	// create a child exit data queue
 	EDQueue* idleEDQ = (EDQueue*)malloc(sizeof(EDQueue));
@@ -618,6 +658,7 @@ void KernelStart(char** argv, unsigned int pmem_size, UserContext* uctx)
 	pIdlePCB->m_prev 		= NULL;
 	pIdlePCB->m_edQ 		= idleEDQ;
 	pIdlePCB->m_name		= NULL;
+	// idle stays out of the process table, or init would always seem to have a live child to Wait for
 
 	// reset to idle's pagetables for successfulyl loading
 	setR1PageTableAlone(pIdlePCB);
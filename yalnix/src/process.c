@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <process.h>
+#include <yalnix.h>
 #include <yalnixutils.h>
 #include <synchronization.h>
 
@@ -83,6 +84,35 @@ void processRemove(PCBQueue* Q, PCB* process)
     Q->m_size--;
 }
 
+/*  Method to move every process of srcQ to the end of destQ in O(1) time
+    srcQ is left empty. Used to wake up a whole list of waiting processes in one batch.
+ */
+void processQueueAppend(PCBQueue* destQ, PCBQueue* srcQ)
+{
+    if(srcQ->m_head == NULL)
+    {
+        // nothing to move
+        return;
+    }
+    else if(destQ->m_head == NULL)
+    {
+        // destination is empty, simply take over the list
+        destQ->m_head = srcQ->m_head;
+        destQ->m_tail = srcQ->m_tail;
+    }
+    else
+    {
+        // patch the source list onto the end of the destination
+        destQ->m_tail->m_next = srcQ->m_head;
+        srcQ->m_head->m_prev = destQ->m_tail;
+        destQ->m_tail = srcQ->m_tail;
+    }
+    destQ->m_size += srcQ->m_size;
+    srcQ->m_head = NULL;
+    srcQ->m_tail = NULL;
+    srcQ->m_size = 0;
+}
+
 // return the PCB with pid in the given queue, or NULL if there is not one
 PCB* getPcbByPid(PCBQueue* Q, int pid)
 {
@@ -188,6 +218,22 @@ PCB* getHeadProcess(PCBQueue* Q)
     return Q->m_head;
 }
 
+// returns the first process with the highest effective priority, so equal priorities stay FIFO
+PCB* getHighestPriorityProcess(PCBQueue* Q)
+{
+    PCB* best = Q->m_head;
+    PCB* curr = Q->m_head;
+    while(curr != NULL)
+    {
+        if(curr->m_priority > best->m_priority)
+        {
+            best = curr;
+        }
+        curr = curr->m_next;
+    }
+    return best;
+}
+
 
 bool isEmptyProcessQueue(PCBQueue* Q)
 {
@@ -227,6 +273,10 @@ void freePCB(PCB* pcb)
     freeRegionOneFrames(pcb); 
     freeKernelStackFrames(pcb);
     exitDataFree(pcb->m_edQ);     // free exit data queue
+    syncRefFree(&pcb->m_heldLocks);
+    syncRefFree(&pcb->m_ownedSyncs);
+    syncRefFree(&pcb->m_sharedSyncs);
+    SAFE_FREE(pcb->m_senderQ);
     SAFE_FREE(pcb->m_uctx);
     SAFE_FREE(pcb->m_kctx);
     SAFE_FREE(pcb->m_pagetable);
@@ -243,6 +293,58 @@ void freeExitedProcesses()
     }
 }
 
+// The process table links every live process, so a pid can be found without
+// knowing which queue the process is blocked in
+void processTableAdd(PCB* pcb)
+{
+    pcb->m_tableNext = gProcessTable;
+    gProcessTable = pcb;
+}
+
+void processTableRemove(PCB* pcb)
+{
+    PCB** link = &gProcessTable;
+    while(*link != NULL)
+    {
+        if(*link == pcb)
+        {
+            *link = pcb->m_tableNext;
+            pcb->m_tableNext = NULL;
+            return;
+        }
+        link = &(*link)->m_tableNext;
+    }
+}
+
+PCB* getProcessByPid(int pid)
+{
+    PCB* curr = gProcessTable;
+    while(curr != NULL)
+    {
+        if(curr->m_pid == pid)
+        {
+            return curr;
+        }
+        curr = curr->m_tableNext;
+    }
+    return NULL;
+}
+
+// finds any live child of ppid, wherever it is blocked. init is its own parent, so it does not count
+PCB* getChildByPpid(int ppid)
+{
+    PCB* curr = gProcessTable;
+    while(curr != NULL)
+    {
+        if(curr->m_ppid == ppid && curr->m_pid != ppid)
+        {
+            return curr;
+        }
+        curr = curr->m_tableNext;
+    }
+    return NULL;
+}
+
 void exitDataEnqueue(EDQueue* Q, ExitData* exitData)
 {
     if (Q->m_head == NULL) {
@@ -272,3 +374,51 @@ void exitDataFree(EDQueue* Q)
         curr = next;
     }
 }
+
+int pollWaiterAdd(PollWaiter** list, PCB* pcb)
+{
+    PollWaiter* waiter = (PollWaiter*)malloc(sizeof(PollWaiter));
+    if(waiter == NULL)
+    {
+        TracePrintf(MODERATE, "ERROR: Unable to allocate memory for a poll waiter\n");
+        return ERROR;
+    }
+    waiter->m_pcb = pcb;
+    waiter->m_next = *list;
+    *list = waiter;
+    return SUCCESS;
+}
+
+void pollWaiterRemove(PollWaiter** list, PCB* pcb)
+{
+    PollWaiter* prev = NULL;
+    PollWaiter* curr = *list;
+    while(curr != NULL)
+    {
+        if(curr->m_pcb == pcb)
+        {
+            if(prev == NULL) *list = curr->m_next;
+            else prev->m_next = curr->m_next;
+            free(curr);
+            return;
+        }
+        prev = curr;
+        curr = curr->m_next;
+    }
+}
+
+// moves every poller on the list that is still blocked to the ready to run queue.
+// the pollers take their waiters off the lists themselves once they run
+void wakePollers(PollWaiter* list)
+{
+    while(list != NULL)
+    {
+        PCB* pcb = list->m_pcb;
+        if(getPcbByPid(&gPollBlockedQ, pcb->m_pid) == pcb)
+        {
+            processRemove(&gPollBlockedQ, pcb);
+            processEnqueue(&gReadyToRunProcessQ, pcb);
+        }
+        list = list->m_next;
+    }
+}
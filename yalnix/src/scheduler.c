@@ -3,7 +3,9 @@
 */
 
 #include <process.h>
+#include <scheduler.h>
 #include <yalnix.h>
+#include <yalnixutils.h>
 
 extern KernelContext* SwitchKCS(KernelContext* kc_in, void* curr_pcb_p, void* next_pcb_p);
 
@@ -23,12 +25,101 @@ void scheduleSleepingProcesses()
 	}
 }
 
+// arms a timer for a process that is about to block in waitingQueue
+int addKernelTimer(PCB* pcb, PCBQueue* waitingQueue, int ticks)
+{
+    KernelTimer* timer = (KernelTimer*)malloc(sizeof(KernelTimer));
+    if(timer == NULL)
+    {
+        TracePrintf(MODERATE, "ERROR: Unable to allocate memory for kernel timer\n");
+        return ERROR;
+    }
+    timer->m_pcb = pcb;
+    timer->m_waitingQueue = waitingQueue;
+    timer->m_ticks = ticks;
+    timer->m_next = gKernelTimers;
+    gKernelTimers = timer;
+    pcb->m_timedOut = 0;
+    return SUCCESS;
+}
+
+// disarms the timer of a process. Safe to call if the timer has already expired
+void cancelKernelTimer(PCB* pcb)
+{
+    KernelTimer* prev = NULL;
+    KernelTimer* curr = gKernelTimers;
+    while(curr != NULL)
+    {
+        if(curr->m_pcb == pcb)
+        {
+            if(prev == NULL) gKernelTimers = curr->m_next;
+            else prev->m_next = curr->m_next;
+            free(curr);
+            return;
+        }
+        prev = curr;
+        curr = curr->m_next;
+    }
+}
+
+// Called on every clock tick. Expired waiters that are still blocked are moved to the ready to run queue.
+// A waiter that was already woken up by a release/signal is no longer in its waiting queue and is left alone.
+void scheduleTimedOutProcesses()
+{
+    KernelTimer* prev = NULL;
+    KernelTimer* curr = gKernelTimers;
+    while(curr != NULL)
+    {
+        KernelTimer* next = curr->m_next;
+        curr->m_ticks--;
+        if(curr->m_ticks <= 0)
+        {
+            PCB* pcb = curr->m_pcb;
+            if(getPcbByPid(curr->m_waitingQueue, pcb->m_pid) == pcb)
+            {
+                processRemove(curr->m_waitingQueue, pcb);
+                pcb->m_timedOut = 1;
+                processEnqueue(&gReadyToRunProcessQ, pcb);
+            }
+            if(prev == NULL) gKernelTimers = next;
+            else prev->m_next = next;
+            free(curr);
+        }
+        else
+        {
+            prev = curr;
+        }
+        curr = next;
+    }
+}
+
 int scheduler(PCBQueue* destQueue, PCB* currpcb, UserContext* ctx, char* errormessage)
+{
+    PCB* nextpcb = getHighestPriorityProcess(&gReadyToRunProcessQ);
+    return switchToProcess(destQueue, currpcb, nextpcb, ctx, errormessage);
+}
+
+// Blocks currpcb in destQueue like scheduler(), but runs nextpcb (which must be ready to run) right away
+// with the rest of the caller's quantum. Used by IPC so a client and its server trade the cpu directly.
+// Falls back to the scheduler if a higher priority process is waiting
+int handoff(PCBQueue* destQueue, PCB* currpcb, PCB* nextpcb, UserContext* ctx, char* errormessage)
+{
+    PCB* bestpcb = getHighestPriorityProcess(&gReadyToRunProcessQ);
+    if(bestpcb != NULL && bestpcb->m_priority > nextpcb->m_priority)
+    {
+        return scheduler(destQueue, currpcb, ctx, errormessage);
+    }
+    nextpcb->m_ticks = currpcb->m_ticks;
+    nextpcb->m_donatedQuantum = 1;
+    return switchToProcess(destQueue, currpcb, nextpcb, ctx, errormessage);
+}
+
+// Moves currpcb from running to destQueue and switches to nextpcb. Returns once currpcb runs again
+int switchToProcess(PCBQueue* destQueue, PCB* currpcb, PCB* nextpcb, UserContext* ctx, char* errormessage)
 {
     processDequeue(&gRunningProcessQ);
     processEnqueue(destQueue, currpcb);
 
-    PCB* nextpcb = getHeadProcess(&gReadyToRunProcessQ);
     memcpy(currpcb->m_uctx, ctx, sizeof(UserContext));
     if(nextpcb != NULL)
     {
@@ -47,7 +138,16 @@ int scheduler(PCBQueue* destQueue, PCB* currpcb, UserContext* ctx, char* errorme
 
     processRemove(&gReadyToRunProcessQ, currpcb);
     processEnqueue(&gRunningProcessQ, currpcb);
-    currpcb->m_ticks = 0;
+
+    // a process handed the cpu keeps counting from where the donor left off
+    if(currpcb->m_donatedQuantum)
+    {
+        currpcb->m_donatedQuantum = 0;
+    }
+    else
+    {
+        currpcb->m_ticks = 0;
+    }
 
     // swap out the page tables
     swapPageTable(currpcb);
@@ -30,9 +30,73 @@ void lockWaitingEnqueue(LockQueueNode* lockNode, PCB* pcb)
     processEnqueue(lockNode->m_waitingQueue, pcb);
 }
 
+// hands out the lock to the highest priority waiter, FIFO among equals
 PCB* lockWaitingDequeue(LockQueueNode* lockNode)
 {
-    return processDequeue(lockNode->m_waitingQueue);
+    PCB* pcb = getHighestPriorityProcess(lockNode->m_waitingQueue);
+    if(pcb != NULL)
+    {
+        processRemove(lockNode->m_waitingQueue, pcb);
+    }
+    return pcb;
+}
+
+void donatePriority(PCB* waiter, LockQueueNode* lockNode)
+{
+    int depth = 0;
+    while(lockNode != NULL && depth < MAX_DONATION_DEPTH)
+    {
+        PCB* holder = lockNode->m_holderPcb;
+        if(holder == NULL || holder->m_priority >= waiter->m_priority)
+        {
+            // nothing more to raise along the chain
+            break;
+        }
+        holder->m_priority = waiter->m_priority;
+        lockNode = holder->m_blockedOnLock;
+        depth++;
+    }
+}
+
+void withdrawPriority(LockQueueNode* lockNode)
+{
+    int depth = 0;
+    while(lockNode != NULL && depth < MAX_DONATION_DEPTH)
+    {
+        PCB* holder = lockNode->m_holderPcb;
+        if(holder == NULL)
+        {
+            break;
+        }
+
+        // each holder waits in the next lock's queue, so the next refresh sees its lowered priority
+        refreshPriority(holder);
+        lockNode = holder->m_blockedOnLock;
+        depth++;
+    }
+}
+
+void refreshPriority(PCB* pcb)
+{
+    int priority = pcb->m_basePriority;
+    SyncRef* ref = pcb->m_heldLocks;
+    while(ref != NULL)
+    {
+        if(getSyncType(ref->m_id) == SYNC_LOCK)
+        {
+            LockQueueNode* lockNode = getLockNode(ref->m_id);
+            if(lockNode != NULL)
+            {
+                PCB* waiter = getHighestPriorityProcess(lockNode->m_waitingQueue);
+                if(waiter != NULL && waiter->m_priority > priority)
+                {
+                    priority = waiter->m_priority;
+                }
+            }
+        }
+        ref = ref->m_next;
+    }
+    pcb->m_priority = priority;
 }
 
 LockQueueNode* getLockNode(int lockId)
@@ -100,6 +164,7 @@ int createLock(int pid)
     }
     newLock->m_id = getUniqueSyncId(SYNC_LOCK);
     newLock->m_owner = pid;
+    newLock->m_users = 1;
     newLock->m_state = UNLOCKED;
 
     // initialize new PCBQueue for the waiting list
@@ -119,6 +184,7 @@ int createLock(int pid)
     newLockQueueNode->m_lock = newLock;
     newLockQueueNode->m_waitingQueue = newPCBQueue;
     newLockQueueNode->m_holder = -1;
+    newLockQueueNode->m_holderPcb = NULL;
     newLockQueueNode->m_next = NULL;
 
     // put the LockQueueNode in the LockQueue
@@ -135,6 +201,11 @@ int freeLock(LockQueueNode* lockNode){
         // still processes waiting so return Error
         return ERROR;
     }
+    if(lockNode->m_lock->m_state == LOCKED)
+    {
+        // somebody still holds the lock
+        return ERROR;
+    }
     removeLockNode(lockNode);
     SAFE_FREE(lockNode->m_waitingQueue);
     SAFE_FREE(lockNode->m_lock);
@@ -142,6 +213,279 @@ int freeLock(LockQueueNode* lockNode){
     return SUCCESS;
 }
 
+/***** Reader-writer lock functions *****/
+void rwlockNodeEnqueue(RWLockQueueNode* rwlockQueueNode)
+{
+    if(gRWLockQueue.m_head == NULL)
+    {
+        // empty list
+        gRWLockQueue.m_head = rwlockQueueNode;
+        gRWLockQueue.m_tail = rwlockQueueNode;
+        rwlockQueueNode->m_next = NULL;
+    }
+    else
+    {
+        // add to end
+        gRWLockQueue.m_tail->m_next = rwlockQueueNode;
+        rwlockQueueNode->m_next = NULL;
+        gRWLockQueue.m_tail = rwlockQueueNode;
+    }
+}
+
+RWLockQueueNode* getRWLockNode(int rwlockId)
+{
+    RWLockQueueNode* currRWLockNode = gRWLockQueue.m_head;
+    while(currRWLockNode != NULL)
+    {
+        if(currRWLockNode->m_rwlock->m_id == rwlockId)
+        {
+            return currRWLockNode;
+        }
+        currRWLockNode = currRWLockNode->m_next;
+    }
+    return NULL;
+}
+
+int removeRWLockNode(RWLockQueueNode* rwlockNode)
+{
+    if(rwlockNode == gRWLockQueue.m_head && rwlockNode == gRWLockQueue.m_tail)
+    {
+        // removing the only item in the list
+        gRWLockQueue.m_head = NULL;
+        gRWLockQueue.m_tail = NULL;
+        rwlockNode->m_next = NULL;
+        return SUCCESS;
+    }
+    else if(rwlockNode == gRWLockQueue.m_head)
+    {
+        // removing the head
+        gRWLockQueue.m_head = rwlockNode->m_next;
+        rwlockNode->m_next = NULL;
+        return SUCCESS;
+    }
+    else
+    {
+        // normal case
+        RWLockQueueNode* currNode = gRWLockQueue.m_head;
+        while(currNode->m_next != NULL)
+        {
+            if(currNode->m_next == rwlockNode)
+            {
+                // patch up the LL and return
+                currNode->m_next = currNode->m_next->m_next;
+                rwlockNode->m_next = NULL;
+                if(rwlockNode == gRWLockQueue.m_tail)
+                {
+                    gRWLockQueue.m_tail = currNode;
+                }
+                return SUCCESS;
+            }
+            currNode = currNode->m_next;
+        }
+    }
+    // not found
+    return ERROR;
+}
+
+int createRWLock(int pid)
+{
+    // initialize new reader-writer lock
+    RWLock* newRWLock = (RWLock*)malloc(sizeof(RWLock));
+    if(newRWLock == NULL)
+    {
+        return ERROR;
+    }
+    newRWLock->m_id = getUniqueSyncId(SYNC_RWLOCK);
+    newRWLock->m_owner = pid;
+    newRWLock->m_users = 1;
+    newRWLock->m_readers = 0;
+    newRWLock->m_writer = -1;
+
+    // initialize the waiting lists for readers and writers
+    PCBQueue* newReadQueue = (PCBQueue*)malloc(sizeof(PCBQueue));
+    PCBQueue* newWriteQueue = (PCBQueue*)malloc(sizeof(PCBQueue));
+    if(newReadQueue == NULL || newWriteQueue == NULL)
+    {
+        SAFE_FREE(newReadQueue);
+        SAFE_FREE(newWriteQueue);
+        SAFE_FREE(newRWLock);
+        return ERROR;
+    }
+    memset(newReadQueue, 0, sizeof(PCBQueue));
+    memset(newWriteQueue, 0, sizeof(PCBQueue));
+
+    // initialize new RWLockQueueNode
+    RWLockQueueNode* newRWLockQueueNode = (RWLockQueueNode*)malloc(sizeof(RWLockQueueNode));
+    if(newRWLockQueueNode == NULL)
+    {
+        SAFE_FREE(newReadQueue);
+        SAFE_FREE(newWriteQueue);
+        SAFE_FREE(newRWLock);
+        return ERROR;
+    }
+    newRWLockQueueNode->m_rwlock = newRWLock;
+    newRWLockQueueNode->m_readWaitingQueue = newReadQueue;
+    newRWLockQueueNode->m_writeWaitingQueue = newWriteQueue;
+    newRWLockQueueNode->m_next = NULL;
+
+    // put the RWLockQueueNode in the RWLockQueue
+    rwlockNodeEnqueue(newRWLockQueueNode);
+
+    // return the new reader-writer lock's id
+    return newRWLock->m_id;
+}
+
+int freeRWLock(RWLockQueueNode* rwlockNode)
+{
+    RWLock* rwlock = rwlockNode->m_rwlock;
+    if(rwlockNode->m_readWaitingQueue->m_head != NULL || rwlockNode->m_writeWaitingQueue->m_head != NULL)
+    {
+        // still processes waiting so return Error
+        return ERROR;
+    }
+    if(rwlock->m_readers > 0 || rwlock->m_writer != -1)
+    {
+        // somebody still holds the lock
+        return ERROR;
+    }
+    removeRWLockNode(rwlockNode);
+    SAFE_FREE(rwlockNode->m_readWaitingQueue);
+    SAFE_FREE(rwlockNode->m_writeWaitingQueue);
+    SAFE_FREE(rwlockNode->m_rwlock);
+    SAFE_FREE(rwlockNode);
+    return SUCCESS;
+}
+
+/***** Barrier functions *****/
+void barrierNodeEnqueue(BarrierQueueNode* barrierQueueNode)
+{
+    if(gBarrierQueue.m_head == NULL)
+    {
+        // empty list
+        gBarrierQueue.m_head = barrierQueueNode;
+        gBarrierQueue.m_tail = barrierQueueNode;
+        barrierQueueNode->m_next = NULL;
+    }
+    else
+    {
+        // add to end
+        gBarrierQueue.m_tail->m_next = barrierQueueNode;
+        barrierQueueNode->m_next = NULL;
+        gBarrierQueue.m_tail = barrierQueueNode;
+    }
+}
+
+BarrierQueueNode* getBarrierNode(int barrierId)
+{
+    BarrierQueueNode* currBarrierNode = gBarrierQueue.m_head;
+    while(currBarrierNode != NULL)
+    {
+        if(currBarrierNode->m_barrier->m_id == barrierId)
+        {
+            return currBarrierNode;
+        }
+        currBarrierNode = currBarrierNode->m_next;
+    }
+    return NULL;
+}
+
+int removeBarrierNode(BarrierQueueNode* barrierNode)
+{
+    if(barrierNode == gBarrierQueue.m_head && barrierNode == gBarrierQueue.m_tail)
+    {
+        // removing the only item in the list
+        gBarrierQueue.m_head = NULL;
+        gBarrierQueue.m_tail = NULL;
+        barrierNode->m_next = NULL;
+        return SUCCESS;
+    }
+    else if(barrierNode == gBarrierQueue.m_head)
+    {
+        // removing the head
+        gBarrierQueue.m_head = barrierNode->m_next;
+        barrierNode->m_next = NULL;
+        return SUCCESS;
+    }
+    else
+    {
+        // normal case
+        BarrierQueueNode* currNode = gBarrierQueue.m_head;
+        while(currNode->m_next != NULL)
+        {
+            if(currNode->m_next == barrierNode)
+            {
+                // patch up the LL and return
+                currNode->m_next = currNode->m_next->m_next;
+                barrierNode->m_next = NULL;
+                if(barrierNode == gBarrierQueue.m_tail)
+                {
+                    gBarrierQueue.m_tail = currNode;
+                }
+                return SUCCESS;
+            }
+            currNode = currNode->m_next;
+        }
+    }
+    // not found
+    return ERROR;
+}
+
+int createBarrier(int pid, int count)
+{
+    // initialize new barrier
+    Barrier* newBarrier = (Barrier*)malloc(sizeof(Barrier));
+    if(newBarrier == NULL)
+    {
+        return ERROR;
+    }
+    newBarrier->m_id = getUniqueSyncId(SYNC_BARRIER);
+    newBarrier->m_owner = pid;
+    newBarrier->m_users = 1;
+    newBarrier->m_count = count;
+    newBarrier->m_arrived = 0;
+
+    // initialize new PCBQueue for the waiting list
+    PCBQueue* newPCBQueue = (PCBQueue*)malloc(sizeof(PCBQueue));
+    if(newPCBQueue == NULL)
+    {
+        SAFE_FREE(newBarrier);
+        return ERROR;
+    }
+    memset(newPCBQueue, 0, sizeof(PCBQueue));
+
+    // initialize new BarrierQueueNode
+    BarrierQueueNode* newBarrierQueueNode = (BarrierQueueNode*)malloc(sizeof(BarrierQueueNode));
+    if(newBarrierQueueNode == NULL)
+    {
+        SAFE_FREE(newPCBQueue);
+        SAFE_FREE(newBarrier);
+        return ERROR;
+    }
+    newBarrierQueueNode->m_barrier = newBarrier;
+    newBarrierQueueNode->m_waitingQueue = newPCBQueue;
+    newBarrierQueueNode->m_next = NULL;
+
+    // put the BarrierQueueNode in the BarrierQueue
+    barrierNodeEnqueue(newBarrierQueueNode);
+
+    // return the new barrier's id
+    return newBarrier->m_id;
+}
+
+int freeBarrier(BarrierQueueNode* barrierNode)
+{
+    if(barrierNode->m_waitingQueue->m_head != NULL)
+    {
+        // still processes waiting so return Error
+        return ERROR;
+    }
+    removeBarrierNode(barrierNode);
+    SAFE_FREE(barrierNode->m_waitingQueue);
+    SAFE_FREE(barrierNode->m_barrier);
+    SAFE_FREE(barrierNode);
+    return SUCCESS;
+}
+
 /***** CVar functions *****/
 void cvarNodeEnqueue(CVarQueueNode* cvarQueueNode)
 {
@@ -236,6 +580,7 @@ int createCVar(int pid)
     }
     newCVar->m_id = getUniqueSyncId(SYNC_CVAR);
     newCVar->m_owner = pid;
+    newCVar->m_users = 1;
     newCVar->m_lockId = -1;
 
     // initialize new PCBQueue for the waiting list
@@ -277,6 +622,158 @@ int freeCVar(CVarQueueNode* cvarNode) // to be implemented when we write kernelR
     return SUCCESS;
 }
 
+/***** per process lists of held and owned primitives *****/
+int syncRefAdd(SyncRef** list, int id)
+{
+    SyncRef* ref = (SyncRef*)malloc(sizeof(SyncRef));
+    if(ref == NULL)
+    {
+        TracePrintf(MODERATE, "ERROR: Unable to allocate memory for sync reference\n");
+        return ERROR;
+    }
+    ref->m_id = id;
+    ref->m_next = *list;
+    *list = ref;
+    return SUCCESS;
+}
+
+// removes one reference to id. Returns ERROR if the id is not in the list
+int syncRefRemove(SyncRef** list, int id)
+{
+    SyncRef* prev = NULL;
+    SyncRef* curr = *list;
+    while(curr != NULL)
+    {
+        if(curr->m_id == id)
+        {
+            if(prev == NULL) *list = curr->m_next;
+            else prev->m_next = curr->m_next;
+            free(curr);
+            return SUCCESS;
+        }
+        prev = curr;
+        curr = curr->m_next;
+    }
+    return ERROR;
+}
+
+// unlinks the first reference and returns it. The caller frees it
+SyncRef* syncRefPop(SyncRef** list)
+{
+    SyncRef* ref = *list;
+    if(ref != NULL)
+    {
+        *list = ref->m_next;
+        ref->m_next = NULL;
+    }
+    return ref;
+}
+
+void syncRefFree(SyncRef** list)
+{
+    SyncRef* curr = *list;
+    while(curr != NULL)
+    {
+        SyncRef* next = curr->m_next;
+        free(curr);
+        curr = next;
+    }
+    *list = NULL;
+}
+
+void orphanSyncObject(int id)
+{
+    SyncType t = getSyncType(id);
+    if(t == SYNC_LOCK)
+    {
+        LockQueueNode* lockNode = getLockNode(id);
+        if(lockNode != NULL) lockNode->m_lock->m_owner = -1;
+    }
+    else if(t == SYNC_CVAR)
+    {
+        CVarQueueNode* cvarNode = getCVarNode(id);
+        if(cvarNode != NULL) cvarNode->m_cvar->m_owner = -1;
+    }
+    else if(t == SYNC_PIPE)
+    {
+        PipeQueueNode* pipeNode = getPipeNode(id);
+        if(pipeNode != NULL) pipeNode->m_pipe->m_owner = -1;
+    }
+    else if(t == SYNC_RWLOCK)
+    {
+        RWLockQueueNode* rwlockNode = getRWLockNode(id);
+        if(rwlockNode != NULL) rwlockNode->m_rwlock->m_owner = -1;
+    }
+    else if(t == SYNC_BARRIER)
+    {
+        BarrierQueueNode* barrierNode = getBarrierNode(id);
+        if(barrierNode != NULL) barrierNode->m_barrier->m_owner = -1;
+    }
+}
+
+int* getSyncUsers(int id)
+{
+    SyncType t = getSyncType(id);
+    if(t == SYNC_LOCK)
+    {
+        LockQueueNode* lockNode = getLockNode(id);
+        if(lockNode != NULL) return &lockNode->m_lock->m_users;
+    }
+    else if(t == SYNC_CVAR)
+    {
+        CVarQueueNode* cvarNode = getCVarNode(id);
+        if(cvarNode != NULL) return &cvarNode->m_cvar->m_users;
+    }
+    else if(t == SYNC_PIPE)
+    {
+        PipeQueueNode* pipeNode = getPipeNode(id);
+        if(pipeNode != NULL) return &pipeNode->m_pipe->m_users;
+    }
+    else if(t == SYNC_RWLOCK)
+    {
+        RWLockQueueNode* rwlockNode = getRWLockNode(id);
+        if(rwlockNode != NULL) return &rwlockNode->m_rwlock->m_users;
+    }
+    else if(t == SYNC_BARRIER)
+    {
+        BarrierQueueNode* barrierNode = getBarrierNode(id);
+        if(barrierNode != NULL) return &barrierNode->m_barrier->m_users;
+    }
+    return NULL;
+}
+
+void syncShareWithChild(PCB* parent, PCB* child)
+{
+    // the child knows every id the parent knows, so it keeps those primitives alive too
+    SyncRef* lists[2] = { parent->m_ownedSyncs, parent->m_sharedSyncs };
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+        SyncRef* ref = lists[i];
+        while(ref != NULL)
+        {
+            int* users = getSyncUsers(ref->m_id);
+            if(users != NULL && syncRefAdd(&child->m_sharedSyncs, ref->m_id) == SUCCESS)
+            {
+                (*users)++;
+            }
+            ref = ref->m_next;
+        }
+    }
+}
+
+int dropSyncUser(int id)
+{
+    int* users = getSyncUsers(id);
+    if(users == NULL)
+    {
+        // already reclaimed
+        return 0;
+    }
+    (*users)--;
+    return *users;
+}
+
 /***** utility functions *****/
 int getUniqueSyncId(SyncType t)
 {
@@ -287,6 +784,10 @@ int getUniqueSyncId(SyncType t)
         return (nextId | CVAR_MASK);
     else if(t == SYNC_PIPE)
         return (nextId | PIPE_MASK);
+    else if(t == SYNC_RWLOCK)
+        return (nextId | RWLOCK_MASK);
+    else if(t == SYNC_BARRIER)
+        return (nextId | BARRIER_MASK);
     else
     {
         TracePrintf(MILD, "INVALID SyncType passed.!!");
@@ -296,10 +797,12 @@ int getUniqueSyncId(SyncType t)
 
 SyncType getSyncType(int compoundId)
 {
-    int type = (compoundId & 0x30000000) >> SYNC_SHIFT;
+    int type = (compoundId & SYNC_TYPE_MASK) >> SYNC_SHIFT;
     if(type == 1) return SYNC_LOCK;
     else if(type == 2) return SYNC_CVAR;
     else if(type == 3) return SYNC_PIPE;
+    else if(type == 4) return SYNC_RWLOCK;
+    else if(type == 5) return SYNC_BARRIER;
     else
     {
         TracePrintf(MILD, "ERROR: Invalid Sync Type\n");
@@ -313,17 +816,78 @@ int getSyncIdOnly(int compoundId)
     return (compoundId & 0x0FFFFFFF);
 }
 
+// releases the frames that back a page backed pipe
+void freePipeFrames(Pipe* pipe)
+{
+    int i;
+    for(i = 0; i < pipe->m_numFrames; i++)
+    {
+        releaseFrame(pipe->m_frames[i]);
+    }
+    SAFE_FREE(pipe->m_frames);
+    pipe->m_frames = NULL;
+    pipe->m_numFrames = 0;
+}
+
+// grabs enough frames to hold size bytes for the pipe
+int allocPipeFrames(Pipe* pipe, int size)
+{
+    int numFrames = (size + PAGESIZE - 1) / PAGESIZE;
+    pipe->m_frames = (unsigned int*)malloc(sizeof(unsigned int) * numFrames);
+    if(pipe->m_frames == NULL) return ERROR;
+    pipe->m_numFrames = 0;
+    while(pipe->m_numFrames < numFrames)
+    {
+        if(gFreeFramePool.m_next == NULL)
+        {
+            TracePrintf(MODERATE, "Out of frames for a page backed pipe\n");
+            freePipeFrames(pipe);
+            return ERROR;
+        }
+        FrameTableEntry* frame = getOneFreeFrame(&gFreeFramePool, &gUsedFramePool);
+        pipe->m_frames[pipe->m_numFrames++] = frame->m_frameNumber;
+    }
+    // the whole frames are usable, and whole page transfers never straddle the end of the pipe
+    pipe->m_size = numFrames * PAGESIZE;
+    return SUCCESS;
+}
+
 // adds a new entry in the global pipe lists
-int pipeEnqueue(int uid)
+int pipeEnqueue(int uid, int pid, int size)
 {
     PipeQueueNode* node = (PipeQueueNode*)malloc(sizeof(PipeQueueNode));
     node->m_pipe = (Pipe*)malloc(sizeof(Pipe));
     if(node->m_pipe != NULL)
     {
         node->m_pipe->m_wLength = 0;
-        node->m_pipe->m_buffer = (void*)malloc(sizeof(char) * PIPE_BUFFER_LEN);
-        if(node->m_pipe->m_buffer == NULL) return -1;
+        node->m_pipe->m_head = 0;
+        node->m_pipe->m_size = size;
+        node->m_pipe->m_buffer = NULL;
+        node->m_pipe->m_frames = NULL;
+        node->m_pipe->m_numFrames = 0;
+        if(size > PIPE_BUFFER_LEN)
+        {
+            if(allocPipeFrames(node->m_pipe, size) != SUCCESS)
+            {
+                SAFE_FREE(node->m_pipe);
+                SAFE_FREE(node);
+                return ERROR;
+            }
+        }
+        else
+        {
+            node->m_pipe->m_buffer = (void*)malloc(sizeof(char) * size);
+            if(node->m_pipe->m_buffer == NULL) return -1;
+        }
         node->m_pipe->m_id = uid;
+        node->m_pipe->m_owner = pid;
+        node->m_pipe->m_users = 1;
+        node->m_readWaitingQueue = (PCBQueue*)malloc(sizeof(PCBQueue));
+        node->m_writeWaitingQueue = (PCBQueue*)malloc(sizeof(PCBQueue));
+        if(node->m_readWaitingQueue == NULL || node->m_writeWaitingQueue == NULL) return -1;
+        memset(node->m_readWaitingQueue, 0, sizeof(PCBQueue));
+        memset(node->m_writeWaitingQueue, 0, sizeof(PCBQueue));
+        node->m_pollers = NULL;
     }
     else
     {
@@ -349,90 +913,50 @@ int pipeEnqueue(int uid)
     return 0;
 }
 
-PipeQueueNode* getPipeNode(int pipeId)
+// adds up the frames backing the pipes the process owns
+int getPipeFramesOwnedBy(PCB* pcb)
 {
-    PipeQueueNode* currPipeQueueNode = gPipeQueue.m_head;
-    while(currPipeQueueNode != NULL)
+    int frames = 0;
+    SyncRef* ref = pcb->m_ownedSyncs;
+    while(ref != NULL)
     {
-        if(currPipeQueueNode->m_pipe->m_id == pipeId)
+        if(getSyncType(ref->m_id) == SYNC_PIPE)
         {
-            return currPipeQueueNode;
+            PipeQueueNode* pipeNode = getPipeNode(ref->m_id);
+            if(pipeNode != NULL) frames += pipeNode->m_pipe->m_numFrames;
         }
-        currPipeQueueNode = currPipeQueueNode->m_next;
+        ref = ref->m_next;
     }
-    return NULL;
+    return frames;
 }
 
-int pipeReadWaitEnqueue(int id, int len, PCB* pcb, void* buff)
+PipeQueueNode* getPipeNode(int pipeId)
 {
-    PipeReadWaitQueueNode* node = (PipeReadWaitQueueNode*)malloc(sizeof(PipeReadWaitQueueNode));
-    if(node != NULL)
+    PipeQueueNode* currPipeQueueNode = gPipeQueue.m_head;
+    while(currPipeQueueNode != NULL)
     {
-        node->m_pcb = pcb;
-        node->m_id = id;
-        node->m_len = len;
-        node->m_buf = buff;
-        if(gPipeReadWaitQueue.m_head == NULL)
-        {
-            gPipeReadWaitQueue.m_head = node;
-            gPipeReadWaitQueue.m_tail = node;
-            node->m_next = NULL;
-        }
-        else
+        if(currPipeQueueNode->m_pipe->m_id == pipeId)
         {
-            gPipeReadWaitQueue.m_tail->m_next = node;
-            node->m_next = NULL;
-            gPipeReadWaitQueue.m_tail = node;
+            return currPipeQueueNode;
         }
-    }
-    else
-    {
-        TracePrintf(MODERATE, "Error allocating memory for pipe read wait queue node\n");
-        return ERROR;
-    }
-    return 0;
-}
-
-PipeReadWaitQueueNode* removePipeReadWaitNode(int id, PCB* pcb)
-{
-    PipeReadWaitQueueNode* prev = gPipeReadWaitQueue.m_head;
-    PipeReadWaitQueueNode* curr = prev;
-    while(curr != NULL && curr->m_pcb != pcb && curr->m_id != id)
-    {
-        prev = curr;
-        curr = curr->m_next;
-    }
-
-    if(curr != NULL)
-    {
-        prev->m_next = curr->m_next;
-        curr->m_next = NULL;
-        return curr;
+        currPipeQueueNode = currPipeQueueNode->m_next;
     }
     return NULL;
 }
 
-void processPendingPipeReadRequests(int pipeid, int currlen)
+// moves the readers at the front of the pipe's wait queue whose requests can now be served to the
+// ready to run queue. Readers are served in arrival order, so we stop at the first one that still
+// has to wait instead of letting smaller requests behind it overtake it
+void wakePipeReaders(PipeQueueNode* pipeNode)
 {
-    PipeReadWaitQueueNode* prev = gPipeReadWaitQueue.m_head;
-    PipeReadWaitQueueNode* curr = prev;
-    while(curr != NULL)
+    int available = pipeNode->m_pipe->m_wLength;
+    PCB* reader = getHeadProcess(pipeNode->m_readWaitingQueue);
+    while(reader != NULL && reader->m_waitLength <= available)
     {
-        // check if any process is waiting on this pipe data
-        if(curr->m_id == pipeid)
-        {
-            if(currlen >= curr->m_len)
-            {
-                // we can move this process to the ready to run queue
-                PCB* wpcb = curr->m_pcb;
-                processEnqueue(&gReadyToRunProcessQ, wpcb);
-                // this node will be free'd upon by the process when it wakes up
-                break;
-            }
-        }
-
-        prev = curr;
-        curr = curr->m_next;
+        available -= reader->m_waitLength;
+        processDequeue(pipeNode->m_readWaitingQueue);
+        processEnqueue(&gReadyToRunProcessQ, reader);
+        reader = getHeadProcess(pipeNode->m_readWaitingQueue);
     }
 }
 
@@ -479,9 +1003,182 @@ int removePipeNode(PipeQueueNode* pipeNode)
 
 int freePipe(PipeQueueNode* pipeNode)
 {
+    if(pipeNode->m_readWaitingQueue->m_head != NULL || pipeNode->m_writeWaitingQueue->m_head != NULL ||
+       pipeNode->m_pollers != NULL)
+    {
+        // still processes waiting so return Error
+        return ERROR;
+    }
     removePipeNode(pipeNode);
+    SAFE_FREE(pipeNode->m_readWaitingQueue);
+    SAFE_FREE(pipeNode->m_writeWaitingQueue);
+    freePipeFrames(pipeNode->m_pipe);
     SAFE_FREE(pipeNode->m_pipe->m_buffer);
     SAFE_FREE(pipeNode->m_pipe);
     SAFE_FREE(pipeNode);
     return SUCCESS;
 }
+
+// copies len bytes between buf and the pipe contents starting at offset, wrapping around the
+// end of the pipe. Page backed pipes are reached one frame at a time through the kernel window
+void pipeTransfer(Pipe* pipe, int offset, char* buf, int len, int toPipe)
+{
+    while(len > 0)
+    {
+        // copy up to the end of the pipe, and for page backed pipes up to the end of the frame
+        int chunk = pipe->m_size - offset;
+        char* dest;
+        if(pipe->m_frames != NULL)
+        {
+            int pageOffset = offset % PAGESIZE;
+            if(chunk > PAGESIZE - pageOffset) chunk = PAGESIZE - pageOffset;
+            dest = (char*)mapKernelWindow(KWINDOW_PAGE0, pipe->m_frames[offset / PAGESIZE]) + pageOffset;
+        }
+        else
+        {
+            dest = (char*)pipe->m_buffer + offset;
+        }
+        if(chunk > len) chunk = len;
+
+        if(toPipe) memcpy(dest, buf, chunk);
+        else memcpy(buf, dest, chunk);
+
+        buf += chunk;
+        len -= chunk;
+        offset = (offset + chunk) % pipe->m_size;
+    }
+    if(pipe->m_frames != NULL)
+    {
+        unmapKernelWindow(KWINDOW_PAGE0);
+    }
+}
+
+// gives the pipe private copies of the shared frames that a write of len bytes at offset would touch
+int pipeUnshareFrames(Pipe* pipe, int offset, int len)
+{
+    if(pipe->m_frames == NULL || len <= 0) return SUCCESS;
+    int first = offset / PAGESIZE;
+    int count = (offset % PAGESIZE + len + PAGESIZE - 1) / PAGESIZE;
+    int i;
+    for(i = 0; i < count; i++)
+    {
+        int slot = (first + i) % pipe->m_numFrames;
+        unsigned int pfn = pipe->m_frames[slot];
+        if(gFrameShareCount[pfn] > 0)
+        {
+            int copy = copyFrame(pfn);
+            if(copy == ERROR) return ERROR;
+            releaseFrame(pfn);
+            pipe->m_frames[slot] = copy;
+        }
+    }
+    return SUCCESS;
+}
+
+// returns the R1 page of addr if the kernel may remap it for a whole page pipe transfer, ERROR otherwise
+int getRemappableR1Page(PCB* pcb, unsigned int addr)
+{
+    if(addr < VMEM_1_BASE || addr >= VMEM_1_LIMIT || (addr % PAGESIZE) != 0) return ERROR;
+    int r1page = addr / PAGESIZE - gNumPagesR0;
+    PageTableEntry* pte = &pcb->m_pagetable->m_pte[r1page];
+    if(pte->valid == 0) return ERROR;
+    if((pte->prot & PROT_WRITE) == 0 && pcb->m_pagetable->m_cow[r1page] == 0) return ERROR;
+    return r1page;
+}
+
+// Moves whole pages of a page aligned write into a page backed pipe without copying them.
+// The writer's frames are shared with the pipe and become copy on write for the writer.
+// Returns the number of bytes moved, which may be 0 if the write does not qualify
+int pipeSharePagesIn(Pipe* pipe, PCB* pcb, void* buf, int len)
+{
+    int moved = 0;
+    if(pipe->m_frames == NULL) return 0;
+    while(len - moved >= PAGESIZE && pipe->m_size - pipe->m_wLength >= PAGESIZE)
+    {
+        int tail = (pipe->m_head + pipe->m_wLength) % pipe->m_size;
+        int r1page = getRemappableR1Page(pcb, (unsigned int)buf + moved);
+        if(tail % PAGESIZE != 0 || r1page == ERROR) break;
+
+        // drop the pipe's frame for this slot and share the writer's frame instead
+        PageTableEntry* pte = &pcb->m_pagetable->m_pte[r1page];
+        int slot = tail / PAGESIZE;
+        releaseFrame(pipe->m_frames[slot]);
+        pipe->m_frames[slot] = pte->pfn;
+        shareFrame(pte->pfn);
+
+        // the writer keeps reading the same frame but gets its own copy on the first write
+        pte->prot = PROT_READ;
+        pcb->m_pagetable->m_cow[r1page] = 1;
+        WriteRegister(REG_TLB_FLUSH, (unsigned int)buf + moved);
+
+        pipe->m_wLength += PAGESIZE;
+        moved += PAGESIZE;
+    }
+    return moved;
+}
+
+// Moves whole pages from a page backed pipe into a page aligned read buffer without copying them.
+// The reader's frame is replaced by the pipe's frame and the pipe gets a fresh frame for the slot.
+// Returns the number of bytes moved, which may be 0 if the read does not qualify
+int pipeMapPagesOut(Pipe* pipe, PCB* pcb, void* buf, int len)
+{
+    int moved = 0;
+    if(pipe->m_frames == NULL) return 0;
+    while(len - moved >= PAGESIZE && pipe->m_wLength >= PAGESIZE && gFreeFramePool.m_next != NULL)
+    {
+        int r1page = getRemappableR1Page(pcb, (unsigned int)buf + moved);
+        if(pipe->m_head % PAGESIZE != 0 || r1page == ERROR) break;
+
+        // the reader's old frame goes away and it maps the pipe's frame in its place
+        PageTableEntry* pte = &pcb->m_pagetable->m_pte[r1page];
+        int slot = pipe->m_head / PAGESIZE;
+        unsigned int pfn = pipe->m_frames[slot];
+        releaseFrame(pte->pfn);
+        pte->pfn = pfn;
+        if(gFrameShareCount[pfn] > 0)
+        {
+            // the writer still maps this frame
+            pte->prot = PROT_READ;
+            pcb->m_pagetable->m_cow[r1page] = 1;
+        }
+        else
+        {
+            pte->prot = PROT_READ | PROT_WRITE;
+            pcb->m_pagetable->m_cow[r1page] = 0;
+        }
+        WriteRegister(REG_TLB_FLUSH, (unsigned int)buf + moved);
+
+        FrameTableEntry* frame = getOneFreeFrame(&gFreeFramePool, &gUsedFramePool);
+        pipe->m_frames[slot] = frame->m_frameNumber;
+
+        pipe->m_head = (pipe->m_head + PAGESIZE) % pipe->m_size;
+        pipe->m_wLength -= PAGESIZE;
+        moved += PAGESIZE;
+    }
+    if(pipe->m_wLength == 0)
+    {
+        pipe->m_head = 0;
+    }
+    return moved;
+}
+
+// appends len bytes from buf at the tail of the pipe. The caller makes sure they fit
+void pipeCopyIn(Pipe* pipe, void* buf, int len)
+{
+    int tail = (pipe->m_head + pipe->m_wLength) % pipe->m_size;
+    pipeTransfer(pipe, tail, (char*)buf, len, 1);
+    pipe->m_wLength += len;
+}
+
+// removes len bytes from the head of the pipe into buf. The caller makes sure they are there
+void pipeCopyOut(Pipe* pipe, void* buf, int len)
+{
+    pipeTransfer(pipe, pipe->m_head, (char*)buf, len, 0);
+    pipe->m_head = (pipe->m_head + len) % pipe->m_size;
+    pipe->m_wLength -= len;
+    if(pipe->m_wLength == 0)
+    {
+        // start over at the front so that the next write does not have to wrap
+        pipe->m_head = 0;
+    }
+}
@@ -3,7 +3,9 @@
 #include <load_info.h>
 #include <process.h>
 #include <pagetable.h>
+#include <scheduler.h>
 #include <synchronization.h>
+#include <syscalls.h>
 #include <terminal.h>
 #include <unistd.h>
 #include <yalnix.h>
@@ -46,6 +48,8 @@ int kernelFork(void)
         nextpcb->m_ppid = currpcb->m_pid;
         nextpcb->m_ticks = 0;
         nextpcb->m_timeToSleep = 0;
+        nextpcb->m_basePriority = currpcb->m_basePriority;
+        nextpcb->m_priority = currpcb->m_basePriority;
         nextpcb->m_pagetable = nextpt;
         nextpcb->m_brk = currpcb->m_brk;
         memcpy(nextuctx, currpcb->m_uctx, sizeof(UserContext));
@@ -95,8 +99,9 @@ int kernelFork(void)
                     // perform the copy from R1 -> R0(child) address space
                     memcpy(src, dest, PAGESIZE);
 
-                    // give the correct permissions for this frame
-                    nextpt->m_pte[pg].prot = currpt->m_pte[pg].prot;
+                    // give the correct permissions for this frame. pages the parent shares copy on write
+                    // are only read only to catch its writes, the child's copy is private
+                    nextpt->m_pte[pg].prot = currpt->m_cow[pg] ? (PROT_READ | PROT_WRITE) : currpt->m_pte[pg].prot;
 
                     // swap back in the parent's R1 address space
                     WriteRegister(REG_PTBR1, (unsigned int)(currpt->m_pte));
@@ -143,6 +148,8 @@ int kernelFork(void)
             // The parent puts the child in the ready to run queue and goes out doing its thing
             currpcb->m_uctx->regs[0] = nextpcb->m_pid;
             processEnqueue(&gReadyToRunProcessQ, nextpcb);
+            processTableAdd(nextpcb);
+            syncShareWithChild(currpcb, nextpcb);
         }
         return SUCCESS;
     }
@@ -470,25 +477,8 @@ void kernelExit(int status, UserContext* ctx)
         Halt();
     }
 
-    // get the parent PCB of the calling process if it exists
-    // TODO also need to search all ttyread waiting queues
-    PCB* parentpcb = getPcbByPid(&gReadyToRunProcessQ, currpcb->m_ppid);
-    if(parentpcb == NULL)
-    {
-        parentpcb = getPcbByPid(&gSleepBlockedQ, currpcb->m_ppid);
-    }
-    if(parentpcb == NULL)
-    {
-        parentpcb = getPcbByPid(&gWaitProcessQ, currpcb->m_ppid);
-    }
-    if(parentpcb == NULL)
-    {
-        parentpcb = getPcbByPidInLocks(currpcb->m_ppid);
-    }
-    if(parentpcb == NULL)
-    {
-        parentpcb = getPcbByPidInCVars(currpcb->m_ppid);
-    }
+    // get the parent PCB of the calling process if it exists. the table has it wherever it is blocked
+    PCB* parentpcb = getProcessByPid(currpcb->m_ppid);
 
     // if the process has a parent, save its exit data into its parents list
     if(parentpcb != NULL)
@@ -516,6 +506,14 @@ void kernelExit(int status, UserContext* ctx)
         }
     }
 
+    // hand every lock we still hold to its next waiter, then reclaim what we own
+    releaseHeldLocks(currpcb);
+    reclaimOwnedSyncs(currpcb);
+
+    // nobody can send to us anymore, and whoever is waiting on us has to be let go
+    processTableRemove(currpcb);
+    ipcCleanup(currpcb);
+
     char* errormessage = "kernelExit";
     scheduler(&gExitedQ, currpcb, ctx, errormessage);
 
@@ -523,18 +521,63 @@ void kernelExit(int status, UserContext* ctx)
     Halt();
 }
 
+// Releases every lock and reader-writer lock held by the (running) process pcb.
+// Each release hands the lock to the next waiter, so nobody is left blocked on a dead holder
+void releaseHeldLocks(PCB* pcb)
+{
+    while(pcb->m_heldLocks != NULL)
+    {
+        // a successful release removes the reference from the list
+        int id = pcb->m_heldLocks->m_id;
+        int rc = (getSyncType(id) == SYNC_RWLOCK) ? kernelRWRelease(id) : kernelRelease(id);
+        if(rc != SUCCESS)
+        {
+            // stale reference. drop it ourselves so we do not loop forever
+            syncRefRemove(&pcb->m_heldLocks, id);
+        }
+    }
+}
+
+// Drops pcb's references to the primitives it created or inherited. A primitive is reclaimed
+// once its last user is gone. Those that children still hold, or that somebody is blocked on,
+// lose their owner instead, so a pipe written by an exiting parent can still be read
+void reclaimOwnedSyncs(PCB* pcb)
+{
+    SyncRef* ref = syncRefPop(&pcb->m_ownedSyncs);
+    while(ref != NULL)
+    {
+        if(dropSyncUser(ref->m_id) > 0 || freeSyncObject(ref->m_id) != SUCCESS)
+        {
+            orphanSyncObject(ref->m_id);
+        }
+        free(ref);
+        ref = syncRefPop(&pcb->m_ownedSyncs);
+    }
+
+    ref = syncRefPop(&pcb->m_sharedSyncs);
+    while(ref != NULL)
+    {
+        // the owner may still be alive, so only the last user reclaims
+        if(getSyncUsers(ref->m_id) != NULL && dropSyncUser(ref->m_id) == 0)
+        {
+            freeSyncObject(ref->m_id);
+        }
+        free(ref);
+        ref = syncRefPop(&pcb->m_sharedSyncs);
+    }
+}
+
 // Wait
 int kernelWait(int *status_ptr, UserContext* ctx) {
     PCB* currpcb = getHeadProcess(&gRunningProcessQ);
     ExitData* exitData = exitDataDequeue(currpcb->m_edQ);
-    // find if the running process has children by trawling the process queues
-    bool hasChildProcess =
-        getChildOfPpid(&gReadyToRunProcessQ, currpcb->m_pid) != NULL ||
-        getChildOfPpid(&gWaitProcessQ, currpcb->m_pid) != NULL ||
-        getChildOfPpid(&gSleepBlockedQ, currpcb->m_pid) != NULL ||
-        getPcbByPidInLocks(currpcb->m_pid) != NULL ||
-        getPcbByPidInCVars(currpcb->m_pid) != NULL;
-        // TODO also need to search all ttyread waiting queues
+    // find if the running process has live children in the process table
+    bool hasChildProcess = getChildByPpid(currpcb->m_pid) != NULL;
+
+    if(resolveCopyOnWrite(currpcb, (unsigned int)status_ptr, sizeof(int)) != SUCCESS)
+    {
+        return ERROR;
+    }
 
     if (!hasChildProcess && exitData == NULL)
     {
@@ -629,7 +672,8 @@ int kernelBrk(void *addr)
             currpt->m_pte[brkPgNum - i].valid = 0;
             currpt->m_pte[brkPgNum - i].prot = PROT_NONE;
             int pfn = currpt->m_pte[brkPgNum - i].pfn;
-            freeOneFrame(&gFreeFramePool, &gUsedFramePool, pfn);
+            currpt->m_cow[brkPgNum - i] = 0;
+            releaseFrame(pfn);
             TracePrintf(DEBUG, "The freed page number is %d and the frame number is %d\n", brkPgNum-i, pfn);
         }
     }
@@ -668,211 +712,295 @@ int kernelDelay(int clock_ticks, UserContext* ctx)
 }
 
 // Reads from a terminal
+// Input is buffered by the receive interrupt, so a read only blocks while nothing has arrived.
+// Blocked readers wait in line and are made ready one at a time as input comes in.
+// A read never goes past the end of the next line, and whatever part of the line does not fit
+// into buf is kept for the next read. With nonblock set it returns WOULDBLOCK instead of waiting
 // returns the number of bytes read from the terminal
-// we use -1 for error bytes read
-int kernelTtyRead(int tty_id, void *buf, int len, UserContext* ctx)
+int kernelTtyRead(int tty_id, void *buf, int len, int nonblock, UserContext* ctx)
 {
     PCB* currpcb = getHeadProcess(&gRunningProcessQ);
-    int read = -1;
-    int toread = -1;
-    TerminalRequest* head = &gTermRReqHeads[tty_id];
-
-    // find the first empty slot
-    TerminalRequest* curr = head;
-    TerminalRequest* next = curr->m_next;
-    while(next != NULL)
+    TerminalInput* input = &gTermInput[tty_id];
+    while(input->m_len == 0)
     {
-        curr = next;
-        next = curr->m_next;
-    }
+        if(nonblock) return WOULDBLOCK;
 
-    // create the new entry for this request
-    TerminalRequest* req = (TerminalRequest*)malloc(sizeof(TerminalRequest));
-    if(req == NULL)
-    {
-        TracePrintf(MODERATE, "ERROR: Unable to allocate memory for read request\n");
-        return ERROR;
+        char* errormessage = "kernelTtyRead";
+        scheduler(&gReadBlockedQ[tty_id], currpcb, ctx, errormessage);
     }
 
-    void* bufferR0 = (void*)malloc(sizeof(char) * len);
-    if(bufferR0 == NULL)
+    // stop at the end of the first line
+    int linelen = 0;
+    while(linelen < input->m_len && input->m_buffer[linelen] != '\n')
     {
-        TracePrintf(MODERATE, "ERROR: Unable to allocate memory for read request buffer\n");
-        free(req);
-        return ERROR;
+        linelen++;
     }
+    if(linelen < input->m_len) linelen++;     // include the newline
 
-    req->m_code = TERM_REQ_READ;
-    req->m_pcb = currpcb;
-    req->m_bufferR0 = bufferR0;
-    req->m_bufferR1 = buf;
-    req->m_next = NULL;
-    req->m_len = len;
-    req->m_serviced = 0;
-    req->m_remaining = len;
+    int toread = len > linelen ? linelen : len;
+    if(resolveCopyOnWrite(currpcb, (unsigned int)buf, toread) != SUCCESS) return ERROR;
+    memcpy(buf, input->m_buffer, toread);
+    input->m_len -= toread;
+    memmove(input->m_buffer, input->m_buffer + toread, input->m_len);
 
-    // append the request to the queue of request
-    curr->m_next = req;
+    // leave what is left to the next reader in line
+    termWakeReader(tty_id);
+    return toread;
+}
 
-    // context switch and wait for a receive to happen
-    processRemove(&gRunningProcessQ, currpcb);
-    processEnqueue(&gReadBlockedQ, currpcb);
+// TTYWrite writes to the terminal tty_id
+// The bytes are copied into the terminal's output ring and transmitted behind our back, so the
+// caller only blocks while the ring is full. Each write goes into the ring as a whole, so writes
+// never interleave. Blocked writers wait in line on the terminal and are woken one at a time in order.
+// A write too long for the ring is pinned instead: it waits for its turn, then stays blocked while
+// the transmit interrupt sends it straight out of the caller's pages a chunk at a time.
+// With nonblock set a write that fits the ring either goes in whole right away or returns WOULDBLOCK.
+// A longer one could never go in whole, so it takes as much as fits right away instead
+// returns the number of bytes it wrote to the terminal
+int kernelTtyWrite(int tty_id, void *buf, int len, int nonblock, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    TerminalOutput* out = &gTermOutput[tty_id];
+    int written = 0;
+    if(len > TERM_OUTPUT_LEN && !nonblock)
+    {
+        return kernelTtyWritePinned(tty_id, buf, len, ctx);
+    }
 
-    PCB* nextpcb = getHeadProcess(&gReadyToRunProcessQ);
-    memcpy(currpcb->m_uctx, ctx, sizeof(UserContext));
-    if(nextpcb != NULL)
+    while(written < len)
     {
-        int rc = KernelContextSwitch(SwitchKCS, currpcb, nextpcb);
-        if(rc == -1)
-        {
-            TracePrintf(MODERATE, "Context switch failed in terminal write. Returning without writing\n");
+        int space = TERM_OUTPUT_LEN - out->m_len;
 
-            // remove this node from gTermWReqHeads queue
-            if(removeTerminalRequest(req) != 0)
-            {
-                TracePrintf(MODERATE, "ERROR: Removing the request failed\n");
-            }
-            processRemove(&gReadBlockedQ, currpcb);
-            processEnqueue(&gRunningProcessQ, currpcb);
-            swapPageTable(currpcb);
-            currpcb->m_ticks = 0;
-            return -1;
+        // it is our turn if the terminal was handed to us, or if it is free and nobody is waiting before us
+        bool turn = (out->m_writer == currpcb) ||
+                    (out->m_writer == NULL && isEmptyProcessQueue(&gWriteWaitQ[tty_id]) && !termRequestsPending(tty_id));
+        if(turn && len > TERM_OUTPUT_LEN && space > 0)
+        {
+            // only a nonblocking write gets here. termOutputAppend takes what fits
+            written = termOutputAppend(tty_id, (char*)buf, len);
+            out->m_writer = NULL;
+            termStartTransmit(tty_id);
+            break;
+        }
+        else if(turn && space >= len)
+        {
+            written = termOutputAppend(tty_id, (char*)buf, len);
+            out->m_writer = NULL;
+            termStartTransmit(tty_id);
+        }
+        else if(nonblock)
+        {
+            return WOULDBLOCK;
+        }
+        else
+        {
+            // wait in line for the transmit interrupt to make room
+            currpcb->m_waitLength = len;
+            char* errormessage = "kernelTtyWrite";
+            scheduler(&gWriteWaitQ[tty_id], currpcb, ctx, errormessage);
         }
     }
-    else
-    {
-        TracePrintf(SEVERE, "ERROR: No PCB - Inside : kernelTtyRead\n");
-    }
-
-    // we just got awoke
-    // req->serviced would be set by the interrupt in read
-    processRemove(&gReadBlockedQ, currpcb);
-    processEnqueue(&gRunningProcessQ, currpcb);
-    currpcb->m_ticks = 0;
-
-    swapPageTable(currpcb);
-    memcpy(ctx, currpcb->m_uctx, sizeof(UserContext));
-
-    // copy back the stuff into user mode space
-    toread = req->m_serviced > req->m_len ? req->m_len : req->m_serviced;
-    memcpy(req->m_bufferR1, req->m_bufferR0, toread);
 
+    // there may be room for queued asynchronous writes or the next one in line already
+    termFillFromRequests(tty_id);
+    termWakeWriter(tty_id);
 
-
-    read = toread;
-    if(removeTerminalRequest(req) != 0)
-        TracePrintf(MODERATE, "ERROR: Removing the request failed\n");
-    return read;
+    // return the amount that was written
+    return written;
 }
 
-// TTYWrite writes to the terminal tty_id
-// returns the number of bytes it wrote to the terminal
-// the only way to return an error is by returning a value that is not equal to the len
-// we use -1 in this case
-int kernelTtyWrite(int tty_id, void *buf, int len, UserContext* ctx)
+// Writes a buffer too long for the output ring without copying it into the kernel. Once it is our
+// turn we own the terminal and block, and the transmit interrupt stages one chunk at a time from
+// our pages, which cannot change while we are blocked
+int kernelTtyWritePinned(int tty_id, void *buf, int len, UserContext* ctx)
 {
-    // Add a request to the terminal queue
     PCB* currpcb = getHeadProcess(&gRunningProcessQ);
-    int written = 0;
-
-    // Each process creates a request
-    // create a request and then goes to sleep
-    // when the TRAP_WRITE is received, that process then goes to sleep
-    // picks the first process in the queue allowing it to finish
-        // the process wakes here
-        // if its done with its work, it puts itself in running queue
-        // removes itself from the blocked queue
-        // continues out of this call
-
-    TerminalRequest* head = &gTermWReqHeads[tty_id];
-
-    // if the head's next pointer is not null, then it means some other process is currently writing
-    // context switch till its get done by spinning till you get a chance
-    while(head->m_next != NULL)
-    {
-        char* errormessage = "kernelTtyWrite 1";
-        scheduler(&gReadyToRunProcessQ, currpcb, ctx, errormessage);
-    }
-
-    // create the new entry for this request
-    TracePrintf(DEBUG, "INFO: PID : %d is about do a terminal write\n", currpcb->m_pid);
-    TerminalRequest* req = (TerminalRequest*)malloc(sizeof(TerminalRequest));
-    if(req == NULL)
+    TerminalOutput* out = &gTermOutput[tty_id];
+    if(checkProcessRange(currpcb, (unsigned int)buf, len, 0) != SUCCESS)
     {
-        TracePrintf(MODERATE, "Error: Couldnt allocate memory for terminal request");
         return ERROR;
     }
 
-    void* bufferR0 = (void*)malloc(sizeof(char) * len);
-    if(bufferR0 == NULL)
+    // wait for our turn. we need no room in the ring
+    while(!(out->m_writer == currpcb ||
+            (out->m_writer == NULL && isEmptyProcessQueue(&gWriteWaitQ[tty_id]) && !termRequestsPending(tty_id))))
     {
-        TracePrintf(MODERATE, "Error could not allocate memory for storing the amount %d bytes within the request\n", len);
-        free(req);
-        return ERROR;
+        currpcb->m_waitLength = 0;
+        char* errormessage = "kernelTtyWritePinned 1";
+        scheduler(&gWriteWaitQ[tty_id], currpcb, ctx, errormessage);
     }
 
+    // the one pinned write of the terminal lives in the terminal itself
+    TerminalRequest* req = &out->m_pinnedReq;
     memset(req, 0, sizeof(TerminalRequest));
     req->m_code = TERM_REQ_WRITE;
     req->m_pcb = currpcb;
-    req->m_bufferR0 = bufferR0;
-    memcpy(req->m_bufferR0, buf, sizeof(char) * len);
-    req->m_next = NULL;
+    req->m_bufferR1 = buf;
     req->m_len = len;
-    req->m_serviced = 0;
     req->m_remaining = len;
-    req->m_next = NULL;
 
-    // append the request to the queue of request
-    head->m_next = req;
+    out->m_writer = currpcb;
+    out->m_pinned = req;
+    termStartTransmit(tty_id);
+    char* errormessage = "kernelTtyWritePinned 2";
+    scheduler(&gWriteWaitQ[tty_id], currpcb, ctx, errormessage);
+
+    // everything went out, or our pages could not be read
+    int written = req->m_serviced;
+    out->m_pinned = NULL;
+    out->m_writer = NULL;
+
+    termStartTransmit(tty_id);
+    termFillFromRequests(tty_id);
+    termWakeWriter(tty_id);
+    return written;
+}
 
-    int iter = len / TERMINAL_MAX_LINE;
-    if(len % TERMINAL_MAX_LINE != 0) iter += 1;     // add one more iter if we dont have perfect sizes
-    int i;
-    for(i = 0; i < iter; i++)
+// Starts writing buf to the terminal and returns a ticket without waiting. Whatever does not fit into
+// the output ring right now is copied into a pooled request that goes in before any later writer.
+// Returns the ticket, which kernelTtyWaitTicket waits on, WOULDBLOCK if the terminal already has
+// TERM_MAX_REQUESTS writes outstanding, or ERROR for a write longer than TERMINAL_MAX_LINE
+int kernelTtyWriteAsync(int tty_id, void *buf, int len)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    if(len > TERMINAL_MAX_LINE)
+    {
+        TracePrintf(MODERATE, "ERROR: Asynchronous writes are limited to %d bytes\n", TERMINAL_MAX_LINE);
+        return ERROR;
+    }
+
+    // requests that are done hold on to their slot till somebody reaps them
+    TerminalRequest* req = getTerminalRequest(tty_id);
+    if(req == NULL && termReapRequests(tty_id) > 0)
+    {
+        req = getTerminalRequest(tty_id);
+    }
+    if(req == NULL)
+    {
+        return WOULDBLOCK;
+    }
+    req->m_code = TERM_REQ_WRITE;
+    req->m_len = len;
+    req->m_ticket = out->m_nextTicket++;
+
+    bool turn = (out->m_writer == NULL && isEmptyProcessQueue(&gWriteWaitQ[tty_id]) && !termRequestsPending(tty_id));
+    if(turn && TERM_OUTPUT_LEN - out->m_len >= len)
+    {
+        // fits right away. the request only remembers where the write ends
+        termOutputAppend(tty_id, (char*)buf, len);
+        req->m_serviced = len;
+        req->m_endPos = out->m_accepted;
+        termStartTransmit(tty_id);
+    }
+    else
+    {
+        memcpy(req->m_bufferR0, buf, len);
+        req->m_remaining = len;
+    }
+
+    // append the request to the queue of requests
+    TerminalRequest* curr = &gTermWReqHeads[tty_id];
+    while(curr->m_next != NULL)
     {
-        int toSend = req->m_remaining;
-        toSend = toSend > TERMINAL_MAX_LINE ? TERMINAL_MAX_LINE : toSend;
-        TtyTransmit(tty_id, req->m_bufferR0 + req->m_serviced, toSend);
+        curr = curr->m_next;
+    }
+    curr->m_next = req;
+    termFillFromRequests(tty_id);
+    return req->m_ticket;
+}
 
-        // Wait while the io gets written
-        char* errormessage = "kernelTtyWrite 2";
-        scheduler(&gWriteBlockedQ, currpcb, ctx, errormessage);
+// Blocks till the asynchronous write with the given ticket has been transmitted. Tickets of writes
+// that are done are gone from the request queue
+int kernelTtyWaitTicket(int tty_id, int ticket, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(ticket <= 0 || ticket >= gTermOutput[tty_id].m_nextTicket)
+    {
+        return ERROR;
+    }
 
-        while(head->m_next != NULL)
+    while(1)
+    {
+        termReapRequests(tty_id);
+        TerminalRequest* req = gTermWReqHeads[tty_id].m_next;
+        while(req != NULL && req->m_ticket != ticket)
         {
-            // wait if someone else is writing
-            char* errormessage = "kernelTtyWrite 3";
-            scheduler(&gReadyToRunProcessQ, currpcb, ctx, errormessage);
+            req = req->m_next;
         }
-
-        req->m_serviced += toSend;
+        if(req == NULL)
+        {
+            return SUCCESS;
+        }
+        char* errormessage = "kernelTtyWaitTicket";
+        scheduler(&gTicketWaitQ[tty_id], currpcb, ctx, errormessage);
     }
+}
 
-    // remove the request from the queue and associated Memory
-    int serviced = req->m_serviced;
-    if(removeTerminalRequest(req) != 0)
-        TracePrintf(MODERATE, "ERROR: Removing the request failed\n");
-
-    // return the amount that was serviced
-    return serviced;
+// Copies the terminal's counters out, so benchmarks can time terminal I/O in clock ticks
+int kernelTtyStats(int tty_id, TtyStats* stats)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(resolveCopyOnWrite(currpcb, (unsigned int)stats, sizeof(TtyStats)) != SUCCESS) return ERROR;
+
+    stats->m_ticks = gClockTicks;
+    stats->m_lastReceive = gTermInput[tty_id].m_lastReceive;
+    stats->m_received = gTermInput[tty_id].m_received;
+    stats->m_sent = gTermOutput[tty_id].m_sent;
+    stats->m_receives = gTermInput[tty_id].m_receives;
+    stats->m_transmits = gTermOutput[tty_id].m_transmits;
+    return SUCCESS;
 }
 
 int kernelPipeInit(int *pipe_idp)
 {
 	// Create a new pipe with a unique id, owned by the calling process
     // Save the id into pipe_idp
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currpcb, (unsigned int)pipe_idp, sizeof(int), 1) != SUCCESS ||
+       resolveCopyOnWrite(currpcb, (unsigned int)pipe_idp, sizeof(int)) != SUCCESS) return ERROR;
     int uid = getUniqueSyncId(SYNC_PIPE);
     if(uid == 0xFFFFFFFF)
         return ERROR;
     else
     {
-        if(pipeEnqueue(uid) != 0) return ERROR;
+        if(pipeEnqueue(uid, currpcb->m_pid, PIPE_BUFFER_LEN) != 0) return ERROR;
+        syncRefAdd(&currpcb->m_ownedSyncs, uid);
         *pipe_idp = uid;
         return SUCCESS;
     }
 }
 
-int kernelPipeRead(int pipe_id, void *buf, int len)
+// Same as kernelPipeInit but with a capacity of size bytes.
+// Pipes larger than PIPE_BUFFER_LEN are backed by whole frames, charged against the owner's page limit
+int kernelPipeInitEx(int *pipe_idp, int size)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    int numFrames = (size > PIPE_BUFFER_LEN) ? (size + PAGESIZE - 1) / PAGESIZE : 0;
+    if(size <= 0 || numFrames > PIPE_MAX_PAGES)
+    {
+        TracePrintf(MODERATE, "ERROR: Invalid pipe size %d\n", size);
+        return ERROR;
+    }
+    if(checkProcessRange(currpcb, (unsigned int)pipe_idp, sizeof(int), 1) != SUCCESS ||
+       resolveCopyOnWrite(currpcb, (unsigned int)pipe_idp, sizeof(int)) != SUCCESS) return ERROR;
+    if(getPipeFramesOwnedBy(currpcb) + numFrames > PIPE_PROCESS_PAGE_LIMIT)
+    {
+        TracePrintf(MODERATE, "ERROR: Process %d is over its pipe page limit\n", currpcb->m_pid);
+        return ERROR;
+    }
+
+    int uid = getUniqueSyncId(SYNC_PIPE);
+    if(pipeEnqueue(uid, currpcb->m_pid, size) != 0) return ERROR;
+    syncRefAdd(&currpcb->m_ownedSyncs, uid);
+    *pipe_idp = uid;
+    return SUCCESS;
+}
+
+// Reads up to len bytes from the pipe and returns how many were read, blocking only while the pipe is empty.
+// With exact set it keeps reading till all len bytes are in, taking whatever is buffered each time round.
+// Waiting for more than is buffered could deadlock against a writer that needs the space for a whole write,
+// so concurrent exact readers may get their bytes interleaved
+int kernelPipeRead(int pipe_id, void *buf, int len, int exact, UserContext* ctx)
 {
     PipeQueueNode* pipeNode = getPipeNode(pipe_id);
     if(pipeNode == NULL)
@@ -880,62 +1008,167 @@ int kernelPipeRead(int pipe_id, void *buf, int len)
         TracePrintf(MODERATE, "ERROR: Invalid pipe id provided\n");
         return ERROR;
     }
-    else
+    if(len < 0)
+    {
+        TracePrintf(MODERATE, "ERROR: Invalid length provided for the pipe read\n");
+        return ERROR;
+    }
+
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currpcb, (unsigned int)buf, len, 1) != SUCCESS)
+    {
+        TracePrintf(MODERATE, "ERROR: Invalid buffer provided for the pipe read\n");
+        return ERROR;
+    }
+    int read = 0;
+    while(read < len)
     {
         Pipe* p = pipeNode->m_pipe;
-        if(len > p->m_wLength)
+        if(p->m_wLength == 0)
         {
-            // block till we are awoken again
-            PCB* currpcb = processDequeue(&gRunningProcessQ);
-            PCB* nextpcb = getHeadProcess(&gReadyToRunProcessQ);
-            if(pipeReadWaitEnqueue(pipe_id, len, currpcb, buf) != 0)
+            // block till a writer wakes us up. Another reader may still beat us to the data, so check again
+            currpcb->m_waitLength = 1;
+            char* errormessage = "kernelPipeRead";
+            scheduler(pipeNode->m_readWaitingQueue, currpcb, ctx, errormessage);
+
+            // the pipe may have been reclaimed while we were waiting
+            pipeNode = getPipeNode(pipe_id);
+            if(pipeNode == NULL)
             {
-                TracePrintf(MODERATE, "ERROR: Unable to add to wait pipe queue\n");
-                processEnqueue(&gRunningProcessQ, currpcb);
-                swapPageTable(currpcb);
-                return ERROR;
+                TracePrintf(MODERATE, "ERROR: Pipe was reclaimed during the read\n");
+                return (read > 0) ? read : ERROR;
             }
+            continue;
+        }
 
-            if(nextpcb != NULL)
-            {
-                int rc = KernelContextSwitch(SwitchKCS, currpcb, nextpcb);
-                if(rc == -1)
-                {
-                    TracePrintf(SEVERE, "ERROR: Context switch failed\n");
-                    //undo the operations
-                    PipeReadWaitQueueNode* node = removePipeReadWaitNode(pipe_id, currpcb);
-                    SAFE_FREE(node);
-                    processEnqueue(&gRunningProcessQ, currpcb);
-                    swapPageTable(currpcb);
-                    currpcb->m_ticks = 0;
-                    return ERROR;
-                }
-            }
-            else
-            {
-                TracePrintf(SEVERE, "ERROR: No PCB - In : kernelPipeRead\n");
-            }
-            // we are awoken kernelExit
-            PipeReadWaitQueueNode* node = removePipeReadWaitNode(pipe_id, currpcb);
-            SAFE_FREE(node);
-            processEnqueue(&gRunningProcessQ, currpcb);
-            swapPageTable(currpcb);
+        int chunk = (len - read > p->m_wLength) ? p->m_wLength : len - read;
+        char* dest = (char*)buf + read;
+
+        // whole pages are remapped into a page aligned buffer, the rest is copied
+        int moved = pipeMapPagesOut(p, currpcb, dest, chunk);
+        if(resolveCopyOnWrite(currpcb, (unsigned int)dest + moved, chunk - moved) != SUCCESS)
+        {
+            TracePrintf(MODERATE, "ERROR: Out of frames for the pipe read buffer\n");
+            read += moved;
+            return (read > 0) ? read : ERROR;
+        }
+        pipeCopyOut(p, dest + moved, chunk - moved);
+        read += chunk;
+
+        // we made space, so let the blocked writers and pollers try again
+        processQueueAppend(&gReadyToRunProcessQ, pipeNode->m_writeWaitingQueue);
+        wakePollers(pipeNode->m_pollers);
+        if(!exact) break;
+    }
+    return read;                                                    // return what was read.
+}
+
+// Records in every entry which of its events are ready right now. Returns the number of ready entries
+int pollCheck(PollEntry* entries, int n)
+{
+    int ready = 0;
+    int i;
+    for(i = 0; i < n; i++)
+    {
+        int id = entries[i].m_id;
+        int revents = 0;
+        PipeQueueNode* pipeNode = (getSyncType(id) == SYNC_PIPE) ? getPipeNode(id) : NULL;
+        if(pipeNode != NULL)
+        {
+            Pipe* p = pipeNode->m_pipe;
+            if(p->m_wLength > 0) revents |= YPOLL_IN;
+            if(p->m_wLength < p->m_size) revents |= YPOLL_OUT;
+        }
+        else if(id >= 0 && id < NUM_TERMINALS)
+        {
+            if(gTermInput[id].m_len > 0) revents |= YPOLL_IN;
+            if(gTermOutput[id].m_len < TERM_OUTPUT_LEN && gTermOutput[id].m_writer == NULL &&
+               isEmptyProcessQueue(&gWriteWaitQ[id]) && !termRequestsPending(id)) revents |= YPOLL_OUT;
+        }
+        else
+        {
+            revents = YPOLL_ERR;
+        }
+
+        entries[i].m_revents = revents & (entries[i].m_events | YPOLL_ERR);
+        if(entries[i].m_revents != 0) ready++;
+    }
+    return ready;
+}
+
+// Adds (or removes) a poll waiter for pcb on every pipe and terminal in entries
+int pollRegister(PollEntry* entries, int n, PCB* pcb, int add)
+{
+    int i;
+    for(i = 0; i < n; i++)
+    {
+        int id = entries[i].m_id;
+        PollWaiter** list = NULL;
+        PipeQueueNode* pipeNode = (getSyncType(id) == SYNC_PIPE) ? getPipeNode(id) : NULL;
+        if(pipeNode != NULL) list = &pipeNode->m_pollers;
+        else if(id >= 0 && id < NUM_TERMINALS) list = &gTermPollers[id];
+        else continue;
+
+        if(!add) pollWaiterRemove(list, pcb);
+        else if(pollWaiterAdd(list, pcb) != SUCCESS)
+        {
+            // undo the ones we already added
+            pollRegister(entries, i, pcb, 0);
+            return ERROR;
         }
+    }
+    return SUCCESS;
+}
+
+// Waits till one of the pipes or terminals in entries is ready for the events asked for, or the timeout passes.
+// The process waits once in gPollBlockedQ with a waiter on every object, and whichever object gets ready first wakes it
+int kernelPoll(PollEntry* entries, int n, int timeout, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(n < 0 || n > MAX_POLL_ENTRIES)
+    {
+        TracePrintf(MODERATE, "ERROR: Invalid number of poll entries %d\n", n);
+        return ERROR;
+    }
+    // pollCheck reads and writes the entries directly, so they have to be ours and writable
+    if(checkProcessRange(currpcb, (unsigned int)entries, n * sizeof(PollEntry), 1) != SUCCESS ||
+       resolveCopyOnWrite(currpcb, (unsigned int)entries, n * sizeof(PollEntry)) != SUCCESS)
+    {
+        return ERROR;
+    }
+
+    int ready = pollCheck(entries, n);
+    if(ready > 0 || timeout == 0)
+    {
+        return ready;
+    }
 
-        // request served immediately or after context switch
-        int remaining = p->m_wLength - len;
-        memcpy(buf, p->m_buffer, sizeof(char) * len);
-        if(remaining > 0)
+    if(timeout > 0 && addKernelTimer(currpcb, &gPollBlockedQ, timeout) != SUCCESS)
+    {
+        return ERROR;
+    }
+    currpcb->m_timedOut = 0;
+    while(ready == 0 && currpcb->m_timedOut == 0)
+    {
+        if(pollRegister(entries, n, currpcb, 1) != SUCCESS)
         {
-            memcpy(p->m_buffer, p->m_buffer + len, remaining);          // move remaining contents forward
-            memset(p->m_buffer + len, 0, PIPE_BUFFER_LEN - len);        // zero out the pipe effectively cleaning it
+            cancelKernelTimer(currpcb);
+            return ERROR;
         }
-        p->m_wLength -= len;                                            // reset the valid length
-        return len;                                                     // return what was read.
+        char* errormessage = "kernelPoll";
+        scheduler(&gPollBlockedQ, currpcb, ctx, errormessage);
+        pollRegister(entries, n, currpcb, 0);
+        ready = pollCheck(entries, n);
     }
+    cancelKernelTimer(currpcb);
+    currpcb->m_timedOut = 0;
+    return ready;
 }
 
-int kernelPipeWrite(int pipe_id, void *buf, int len)
+// Writes len bytes into the pipe, blocking while the pipe is full.
+// A write that fits into the pipe goes in as a whole so it is never interleaved with other writers,
+// larger writes stream through the pipe in chunks as readers make space
+int kernelPipeWrite(int pipe_id, void *buf, int len, UserContext* ctx)
 {
 	PipeQueueNode* pipeNode = getPipeNode(pipe_id);
     if(pipeNode == NULL)
@@ -943,24 +1176,61 @@ int kernelPipeWrite(int pipe_id, void *buf, int len)
         TracePrintf(MODERATE, "ERROR: Invalid pipe id provided\n");
         return ERROR;
     }
-    else
+    if(len < 0)
+    {
+        TracePrintf(MODERATE, "ERROR: Invalid length provided for the pipe write\n");
+        return ERROR;
+    }
+
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currpcb, (unsigned int)buf, len, 0) != SUCCESS)
+    {
+        TracePrintf(MODERATE, "ERROR: Invalid buffer provided for the pipe write\n");
+        return ERROR;
+    }
+    int written = 0;
+    while(written < len)
     {
         Pipe* p = pipeNode->m_pipe;
-        if(p->m_wLength + len > PIPE_BUFFER_LEN)
+        int chunk = len - written;
+        int space = p->m_size - p->m_wLength;
+        if(chunk > space)
         {
-            TracePrintf(MODERATE, "ERROR: Pipe is full\n");
-            return ERROR;
+            chunk = (len <= p->m_size) ? 0 : space;
         }
-        else
+
+        if(chunk == 0)
         {
-            int offset = p->m_wLength;
-            memcpy(p->m_buffer + offset, buf, sizeof(char) * len);
-            p->m_wLength += len;
-            // move any process that is waiting on a write for this pipe into the ready to run queue
+            // block till a reader makes space
+            char* errormessage = "kernelPipeWrite";
+            scheduler(pipeNode->m_writeWaitingQueue, currpcb, ctx, errormessage);
 
-            return len;
+            // the pipe may have been reclaimed while we were waiting
+            pipeNode = getPipeNode(pipe_id);
+            if(pipeNode == NULL)
+            {
+                TracePrintf(MODERATE, "ERROR: Pipe was reclaimed during the write\n");
+                return (written > 0) ? written : ERROR;
+            }
+            continue;
+        }
+
+        // whole pages of a page aligned write are shared with the pipe, the rest is copied
+        int moved = pipeSharePagesIn(p, currpcb, (char*)buf + written, chunk);
+        written += moved;
+        int tail = (p->m_head + p->m_wLength) % p->m_size;
+        if(pipeUnshareFrames(p, tail, chunk - moved) != SUCCESS)
+        {
+            TracePrintf(MODERATE, "ERROR: Out of frames for the pipe write\n");
+            wakePipeReaders(pipeNode);
+            return (written > 0) ? written : ERROR;
         }
+        pipeCopyIn(p, (char*)buf + written, chunk - moved);
+        written += chunk - moved;
+        wakePipeReaders(pipeNode);
+        wakePollers(pipeNode->m_pollers);
     }
+    return written;
 }
 
 // Create a new lock with a unique id, owned by the calling process, and initially unlocked
@@ -969,12 +1239,15 @@ int kernelPipeWrite(int pipe_id, void *buf, int len)
 int kernelLockInit(int *lock_idp)
 {
     PCB* currPCB = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currPCB, (unsigned int)lock_idp, sizeof(int), 1) != SUCCESS ||
+       resolveCopyOnWrite(currPCB, (unsigned int)lock_idp, sizeof(int)) != SUCCESS) return ERROR;
 
     *lock_idp = createLock(currPCB->m_pid);
     if(*lock_idp == -1)
     {
         return ERROR;
     }
+    syncRefAdd(&currPCB->m_ownedSyncs, *lock_idp);
     return SUCCESS;
 }
 
@@ -998,13 +1271,73 @@ int kernelAcquire(int lock_id, UserContext* ctx)
     {
         // if the lock is free, update the lock's holder and continue running
         lockNode->m_holder = currpcb->m_pid;
+        lockNode->m_holderPcb = currpcb;
         lock->m_state = LOCKED;
+        syncRefAdd(&currpcb->m_heldLocks, lock_id);
     }
     else
     {
         // Else, add the calling process to the lock referenced by lock_id's queue of waiting processes
+        // and lend our priority to the holder so it is not stalled by lower priority processes
+        currpcb->m_blockedOnLock = lockNode;
+        donatePriority(currpcb, lockNode);
         char* errormessage = "kernelAcquire";
         scheduler(lockNode->m_waitingQueue, currpcb, ctx, errormessage);
+        currpcb->m_blockedOnLock = NULL;
+    }
+    return SUCCESS;
+}
+
+// Same as kernelAcquire but gives up after the given number of clock ticks.
+// A tick count of zero or less only tries to take the lock without blocking.
+// Returns TIMEOUT if the lock could not be obtained in time
+int kernelAcquireTimeout(int lock_id, int ticks, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+
+    LockQueueNode* lockNode = getLockNode(lock_id);
+    if(lockNode == NULL)
+    {
+        return ERROR;
+    }
+    else if(lockNode->m_holder == currpcb->m_pid)
+    {
+        // calling process already holds the lock
+        return ERROR;
+    }
+
+    Lock* lock = lockNode->m_lock;
+    if(lock->m_state == UNLOCKED)
+    {
+        lockNode->m_holder = currpcb->m_pid;
+        lockNode->m_holderPcb = currpcb;
+        lock->m_state = LOCKED;
+        syncRefAdd(&currpcb->m_heldLocks, lock_id);
+        return SUCCESS;
+    }
+    else if(ticks <= 0)
+    {
+        return TIMEOUT;
+    }
+
+    // wait in the lock's queue. kernelRelease hands us the lock unless the timer pulls us out first
+    if(addKernelTimer(currpcb, lockNode->m_waitingQueue, ticks) != SUCCESS)
+    {
+        return ERROR;
+    }
+    currpcb->m_blockedOnLock = lockNode;
+    donatePriority(currpcb, lockNode);
+    char* errormessage = "kernelAcquireTimeout";
+    scheduler(lockNode->m_waitingQueue, currpcb, ctx, errormessage);
+    cancelKernelTimer(currpcb);
+    currpcb->m_blockedOnLock = NULL;
+
+    if(currpcb->m_timedOut)
+    {
+        // we gave up, so the holders down the chain no longer need our priority
+        currpcb->m_timedOut = 0;
+        withdrawPriority(lockNode);
+        return TIMEOUT;
     }
     return SUCCESS;
 }
@@ -1030,27 +1363,55 @@ int kernelRelease(int lock_id) {
         // Otherwise unlock the lock and give it to the next waiting process if there is one
         lock->m_state = UNLOCKED;
         lockNode->m_holder = -1;
+        lockNode->m_holderPcb = NULL;
+        syncRefRemove(&currPCB->m_heldLocks, lock_id);
+
+        // drop whatever priority the waiters of this lock lent us
+        refreshPriority(currPCB);
+
         PCB* newLockHolder = lockWaitingDequeue(lockNode);
         if(newLockHolder != NULL)
         {
             lockNode->m_holder = newLockHolder->m_pid;
+            lockNode->m_holderPcb = newLockHolder;
             lock->m_state = LOCKED;
+            syncRefAdd(&newLockHolder->m_heldLocks, lock_id);
+
+            // the new holder inherits the priorities of the processes still waiting
+            refreshPriority(newLockHolder);
             processEnqueue(&gReadyToRunProcessQ, newLockHolder);
         }
         return SUCCESS;
     }
 }
 
+// Sets the base priority of the calling process. The effective priority stays raised
+// while higher priority processes wait on locks we hold
+int kernelSetPriority(int priority)
+{
+    if(priority < 0 || priority > MAX_PRIORITY)
+    {
+        return ERROR;
+    }
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    currpcb->m_basePriority = priority;
+    refreshPriority(currpcb);
+    return SUCCESS;
+}
+
 int kernelCvarInit(int *cvar_idp) {
     // Create a new cvar with a unique id, owned by the calling process
 	// Add the cvar to the gCVarQueue list
     // Save the unique id into cvar_idp
     PCB* currPCB = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currPCB, (unsigned int)cvar_idp, sizeof(int), 1) != SUCCESS ||
+       resolveCopyOnWrite(currPCB, (unsigned int)cvar_idp, sizeof(int)) != SUCCESS) return ERROR;
     *cvar_idp = createCVar(currPCB->m_pid);
     if(*cvar_idp == ERROR)
     {
         return ERROR;
     }
+    syncRefAdd(&currPCB->m_ownedSyncs, *cvar_idp);
     return SUCCESS;
 }
 
@@ -1137,8 +1498,266 @@ int kernelCvarWait(int cvar_id, int lock_id, UserContext* ctx)
     return SUCCESS;
 }
 
+// Create a new reader-writer lock with a unique id, owned by the calling process, and initially free
+// Add the new lock to gRWLockQueue
+// Save its unique id into rwlock_idp
+int kernelRWLockInit(int *rwlock_idp)
+{
+    PCB* currPCB = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currPCB, (unsigned int)rwlock_idp, sizeof(int), 1) != SUCCESS ||
+       resolveCopyOnWrite(currPCB, (unsigned int)rwlock_idp, sizeof(int)) != SUCCESS) return ERROR;
+
+    *rwlock_idp = createRWLock(currPCB->m_pid);
+    if(*rwlock_idp == ERROR)
+    {
+        return ERROR;
+    }
+    syncRefAdd(&currPCB->m_ownedSyncs, *rwlock_idp);
+    return SUCCESS;
+}
+
+int kernelReadAcquire(int rwlock_id, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    RWLockQueueNode* rwlockNode = getRWLockNode(rwlock_id);
+    if(rwlockNode == NULL)
+    {
+        return ERROR;
+    }
+
+    RWLock* rwlock = rwlockNode->m_rwlock;
+    if(rwlock->m_writer == currpcb->m_pid)
+    {
+        // calling process already holds the lock for writing
+        return ERROR;
+    }
+
+    if(rwlock->m_writer == -1 && rwlockNode->m_writeWaitingQueue->m_head == NULL)
+    {
+        // no writer holds or wants the lock, so readers can share it
+        rwlock->m_readers++;
+        syncRefAdd(&currpcb->m_heldLocks, rwlock_id);
+    }
+    else
+    {
+        // a writer holds the lock or is waiting for it, so we wait behind it.
+        // the releasing writer counts us as a reader before waking us up
+        char* errormessage = "kernelReadAcquire";
+        scheduler(rwlockNode->m_readWaitingQueue, currpcb, ctx, errormessage);
+    }
+    return SUCCESS;
+}
+
+int kernelWriteAcquire(int rwlock_id, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    RWLockQueueNode* rwlockNode = getRWLockNode(rwlock_id);
+    if(rwlockNode == NULL)
+    {
+        return ERROR;
+    }
+
+    RWLock* rwlock = rwlockNode->m_rwlock;
+    if(rwlock->m_writer == currpcb->m_pid)
+    {
+        // calling process already holds the lock
+        return ERROR;
+    }
+
+    if(rwlock->m_writer == -1 && rwlock->m_readers == 0)
+    {
+        // the lock is free
+        rwlock->m_writer = currpcb->m_pid;
+        syncRefAdd(&currpcb->m_heldLocks, rwlock_id);
+    }
+    else
+    {
+        // wait till the last holder hands the lock to us
+        char* errormessage = "kernelWriteAcquire";
+        scheduler(rwlockNode->m_writeWaitingQueue, currpcb, ctx, errormessage);
+    }
+    return SUCCESS;
+}
+
+int kernelRWRelease(int rwlock_id)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    RWLockQueueNode* rwlockNode = getRWLockNode(rwlock_id);
+    if(rwlockNode == NULL)
+    {
+        return ERROR;
+    }
+
+    RWLock* rwlock = rwlockNode->m_rwlock;
+    if(syncRefRemove(&currpcb->m_heldLocks, rwlock_id) != SUCCESS)
+    {
+        // the caller does not hold the lock
+        return ERROR;
+    }
+
+    if(rwlock->m_writer == currpcb->m_pid)
+    {
+        rwlock->m_writer = -1;
+    }
+    else
+    {
+        rwlock->m_readers--;
+    }
+
+    if(rwlock->m_readers > 0)
+    {
+        // other readers still hold the lock
+        return SUCCESS;
+    }
+
+    // the lock is free. writers are preferred over readers
+    PCB* nextWriter = processDequeue(rwlockNode->m_writeWaitingQueue);
+    if(nextWriter != NULL)
+    {
+        rwlock->m_writer = nextWriter->m_pid;
+        syncRefAdd(&nextWriter->m_heldLocks, rwlock_id);
+        processEnqueue(&gReadyToRunProcessQ, nextWriter);
+    }
+    else
+    {
+        // wake up every waiting reader in one batch
+        PCB* reader = rwlockNode->m_readWaitingQueue->m_head;
+        while(reader != NULL)
+        {
+            syncRefAdd(&reader->m_heldLocks, rwlock_id);
+            reader = reader->m_next;
+        }
+        rwlock->m_readers = rwlockNode->m_readWaitingQueue->m_size;
+        processQueueAppend(&gReadyToRunProcessQ, rwlockNode->m_readWaitingQueue);
+    }
+    return SUCCESS;
+}
+
+// Create a new barrier for count processes with a unique id, owned by the calling process
+// Save its unique id into barrier_idp
+int kernelBarrierInit(int *barrier_idp, int count)
+{
+    if(count <= 0)
+    {
+        return ERROR;
+    }
+    PCB* currPCB = getHeadProcess(&gRunningProcessQ);
+    if(checkProcessRange(currPCB, (unsigned int)barrier_idp, sizeof(int), 1) != SUCCESS ||
+       resolveCopyOnWrite(currPCB, (unsigned int)barrier_idp, sizeof(int)) != SUCCESS) return ERROR;
+    *barrier_idp = createBarrier(currPCB->m_pid, count);
+    if(*barrier_idp == ERROR)
+    {
+        return ERROR;
+    }
+    syncRefAdd(&currPCB->m_ownedSyncs, *barrier_idp);
+    return SUCCESS;
+}
+
+// Blocks till count processes have called BarrierWait on the barrier.
+// The last one to arrive releases everybody in one batch and keeps running
+int kernelBarrierWait(int barrier_id, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    BarrierQueueNode* barrierNode = getBarrierNode(barrier_id);
+    if(barrierNode == NULL)
+    {
+        return ERROR;
+    }
+
+    Barrier* barrier = barrierNode->m_barrier;
+    barrier->m_arrived++;
+    if(barrier->m_arrived < barrier->m_count)
+    {
+        char* errormessage = "kernelBarrierWait";
+        scheduler(barrierNode->m_waitingQueue, currpcb, ctx, errormessage);
+    }
+    else
+    {
+        // last one in. start the next phase and let everybody go
+        barrier->m_arrived = 0;
+        processQueueAppend(&gReadyToRunProcessQ, barrierNode->m_waitingQueue);
+    }
+    return SUCCESS;
+}
+
+// Same as kernelCvarWait but stops waiting for a signal after the given number of clock ticks.
+// The lock is re-acquired in both cases. Returns TIMEOUT if no signal arrived in time
+int kernelCvarTimedWait(int cvar_id, int lock_id, int ticks, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    CVarQueueNode* cvarNode = getCVarNode(cvar_id);
+    LockQueueNode* lockNode = getLockNode(lock_id);
+    if(cvarNode == NULL || lockNode == NULL)
+    {
+        return ERROR;
+    }
+
+    // Throw error is the calling process doesn't currently hold the lock
+    if(lockNode->m_holder != currpcb->m_pid)
+    {
+        return ERROR;
+    }
+
+    // update the cvars lock id on the first time ONLY, else throw an ERROR
+    if(cvarNode->m_cvar->m_lockId == -1)
+    {
+        cvarNode->m_cvar->m_lockId = lock_id;
+    }
+    else if(cvarNode->m_cvar->m_lockId != lock_id)
+    {
+        return ERROR;
+    }
+
+    // no time to wait at all. still let go of the lock and take it back, as every wait does
+    if(ticks <= 0)
+    {
+        if(kernelRelease(lock_id) == ERROR || kernelAcquire(lock_id, ctx) == ERROR)
+        {
+            return ERROR;
+        }
+        return TIMEOUT;
+    }
+
+    if(addKernelTimer(currpcb, cvarNode->m_waitingQueue, ticks) != SUCCESS)
+    {
+        return ERROR;
+    }
+
+    // Release the lock referenced by lock_id
+    if(kernelRelease(lock_id) == ERROR)
+    {
+        cancelKernelTimer(currpcb);
+        return ERROR;
+    }
+
+    char* errormessage = "kernelCvarTimedWait";
+    scheduler(cvarNode->m_waitingQueue, currpcb, ctx, errormessage);
+    cancelKernelTimer(currpcb);
+
+    int timedOut = currpcb->m_timedOut;
+    currpcb->m_timedOut = 0;
+
+    // Acquire the lock again
+    if(kernelAcquire(lock_id, ctx) == ERROR)
+    {
+        return ERROR;
+    }
+    return timedOut ? TIMEOUT : SUCCESS;
+}
+
 int kernelReclaim(int id) {
-	// If the calling process is not the owner of the lock/cvar/pipe referenced by id, return ERROR
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    int rc = freeSyncObject(id);
+    if(rc == SUCCESS)
+    {
+        // drop it from the owner's list if we are the owner.
+        // an entry left behind in another owner's list is harmless since ids are never reused
+        syncRefRemove(&currpcb->m_ownedSyncs, id);
+    }
+    return rc;
+}
+
+int freeSyncObject(int id) {
 	// Free all resources held by the lock/cvar/pipe (usually nodes and waiting queues)
     // Remove the lock/cvar/pipe from its global list
     SyncType t = getSyncType(id);
@@ -1181,6 +1800,32 @@ int kernelReclaim(int id) {
             return freePipe(pipeNode);
         }
     }
+    else if(t == SYNC_RWLOCK)
+    {
+        RWLockQueueNode* rwlockNode = getRWLockNode(id);
+        if(rwlockNode == NULL)
+        {
+            TracePrintf(MODERATE, "ERROR: Invalid syscall to free a non-existent reader-writer lock\n");
+            return ERROR;
+        }
+        else
+        {
+            return freeRWLock(rwlockNode);
+        }
+    }
+    else if(t == SYNC_BARRIER)
+    {
+        BarrierQueueNode* barrierNode = getBarrierNode(id);
+        if(barrierNode == NULL)
+        {
+            TracePrintf(MODERATE, "ERROR: Invalid syscall to free a non-existent barrier\n");
+            return ERROR;
+        }
+        else
+        {
+            return freeBarrier(barrierNode);
+        }
+    }
     else
     {
         return ERROR;
@@ -1202,7 +1847,7 @@ int safeQueuePS(int tty_id, PCBQueue* queue, char* prefix, UserContext* ctx)
                 int rc = sprintf(buffer, "%s : \n PID : %d\t PPID: %d\t %s\n", prefix, temp->m_pid, temp->m_ppid, temp->m_name);
                 if(rc != -1)
                 {
-                    if(kernelTtyWrite(tty_id, buffer, rc, ctx) != rc)
+                    if(kernelTtyWrite(tty_id, buffer, rc, 0, ctx) != rc)
                         return ERROR;
                     else memset(buffer, 0, 512);
                 }
@@ -1224,7 +1869,7 @@ int kernelPS(int tty_id, UserContext* ctx)
         int rc = sprintf(buffer, "RUNNING : \n PID : %d\t PPID : %d\t %s\n", currpcb->m_pid, currpcb->m_ppid, currpcb->m_name);
         if(rc != -1)
         {
-            if(kernelTtyWrite(tty_id, buffer, rc, ctx) != rc)
+            if(kernelTtyWrite(tty_id, buffer, rc, 0, ctx) != rc)
             {
                 return ERROR;
             }
@@ -1238,13 +1883,20 @@ int kernelPS(int tty_id, UserContext* ctx)
 
         // read blocked queue
         char prefix2[] = "READ_BLOCKED";
-        if(safeQueuePS(tty_id, &gReadBlockedQ, prefix2, ctx) != SUCCESS)
-            return ERROR;
+        int term;
+        for(term = 0; term < NUM_TERMINALS; term++)
+        {
+            if(safeQueuePS(tty_id, &gReadBlockedQ[term], prefix2, ctx) != SUCCESS)
+                return ERROR;
+        }
 
         // write blocked queue
         char prefix3[] = "WRITE_BLOCKED";
-        if(safeQueuePS(tty_id, &gWriteBlockedQ, prefix3, ctx) != SUCCESS)
-            return ERROR;
+        for(term = 0; term < NUM_TERMINALS; term++)
+        {
+            if(safeQueuePS(tty_id, &gWriteWaitQ[term], prefix3, ctx) != SUCCESS)
+                return ERROR;
+        }
 
         return SUCCESS;
     }
@@ -1254,3 +1906,223 @@ int kernelPS(int tty_id, UserContext* ctx)
         return ERROR;
     }
 }
+
+// Registers the calling process as the server for the given index, so clients can Send(msg, -index)
+int kernelRegister(unsigned int index)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(index < 1 || index > MAX_SERVER_INDEX)
+    {
+        TracePrintf(MODERATE, "ERROR: server index %d out of range\n", index);
+        return ERROR;
+    }
+    if(gServerTable[index] != -1)
+    {
+        TracePrintf(MODERATE, "ERROR: server index %d already registered by %d\n", index, gServerTable[index]);
+        return ERROR;
+    }
+    gServerTable[index] = currpcb->m_pid;
+    return SUCCESS;
+}
+
+// Sends a MESSAGE_SIZE message to pid (or to the server registered at -pid) and blocks until the
+// receiver replies. The reply overwrites msg. Returns ERROR if the receiver exits before replying
+int kernelSend(void* msg, int pid, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+
+    // the reply comes back into msg, so it has to be writable too
+    if(checkProcessRange(currpcb, (unsigned int)msg, MESSAGE_SIZE, 1) != SUCCESS)
+    {
+        return ERROR;
+    }
+
+    // negative pids name a server index
+    if(pid < 0)
+    {
+        if(-pid > MAX_SERVER_INDEX || gServerTable[-pid] == -1)
+        {
+            return ERROR;
+        }
+        pid = gServerTable[-pid];
+    }
+
+    PCB* destpcb = getProcessByPid(pid);
+    if(destpcb == NULL || destpcb == currpcb)
+    {
+        return ERROR;
+    }
+    if(destpcb->m_senderQ == NULL)
+    {
+        destpcb->m_senderQ = (PCBQueue*)malloc(sizeof(PCBQueue));
+        if(destpcb->m_senderQ == NULL)
+        {
+            TracePrintf(SEVERE, "Failed to malloc for sender queue\n");
+            return ERROR;
+        }
+        memset(destpcb->m_senderQ, 0, sizeof(PCBQueue));
+    }
+
+    // the message is copied now, while our address space is the one mapped
+    memcpy(currpcb->m_msg, msg, MESSAGE_SIZE);
+    currpcb->m_ipcPartner = pid;
+    currpcb->m_ipcStatus = ERROR;
+
+    // if the receiver is already waiting for us, run it straight away on our quantum
+    char* errormessage = "kernelSend";
+    if(getPcbByPid(&gReceiveBlockedQ, pid) == destpcb &&
+       (destpcb->m_ipcPartner == 0 || destpcb->m_ipcPartner == currpcb->m_pid))
+    {
+        processRemove(&gReceiveBlockedQ, destpcb);
+        processEnqueue(&gReadyToRunProcessQ, destpcb);
+        handoff(destpcb->m_senderQ, currpcb, destpcb, ctx, errormessage);
+    }
+    else
+    {
+        scheduler(destpcb->m_senderQ, currpcb, ctx, errormessage);
+    }
+
+    if(currpcb->m_ipcStatus != SUCCESS)
+    {
+        return ERROR;
+    }
+    resolveCopyOnWrite(currpcb, (unsigned int)msg, MESSAGE_SIZE);
+    memcpy(msg, currpcb->m_msg, MESSAGE_SIZE);
+    return SUCCESS;
+}
+
+// Receives the next message sent to the calling process, or only one from pid if pid is not 0.
+// Blocks until such a message arrives and returns the pid of its sender, who then waits for our Reply
+int kernelReceive(void* msg, int pid, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    if(pid < 0 || pid == currpcb->m_pid || checkProcessRange(currpcb, (unsigned int)msg, MESSAGE_SIZE, 1) != SUCCESS)
+    {
+        return ERROR;
+    }
+
+    while(1)
+    {
+        PCB* senderpcb = NULL;
+        if(currpcb->m_senderQ != NULL)
+        {
+            senderpcb = (pid == 0) ? getHeadProcess(currpcb->m_senderQ) : getPcbByPid(currpcb->m_senderQ, pid);
+        }
+        if(senderpcb != NULL)
+        {
+            processRemove(currpcb->m_senderQ, senderpcb);
+            processEnqueue(&gReplyBlockedQ, senderpcb);
+            resolveCopyOnWrite(currpcb, (unsigned int)msg, MESSAGE_SIZE);
+            memcpy(msg, senderpcb->m_msg, MESSAGE_SIZE);
+            return senderpcb->m_pid;
+        }
+
+        // nobody left to wait for
+        if(pid != 0 && getProcessByPid(pid) == NULL)
+        {
+            return ERROR;
+        }
+
+        currpcb->m_ipcPartner = pid;
+        char* errormessage = "kernelReceive";
+        scheduler(&gReceiveBlockedQ, currpcb, ctx, errormessage);
+    }
+}
+
+// Replies to a sender we have received from, copying msg over its message and switching straight
+// back to it. The caller is put on the ready to run queue
+int kernelReply(void* msg, int pid, UserContext* ctx)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    PCB* senderpcb = getPcbByPid(&gReplyBlockedQ, pid);
+    if(senderpcb == NULL || senderpcb->m_ipcPartner != currpcb->m_pid ||
+       checkProcessRange(currpcb, (unsigned int)msg, MESSAGE_SIZE, 0) != SUCCESS)
+    {
+        return ERROR;
+    }
+
+    memcpy(senderpcb->m_msg, msg, MESSAGE_SIZE);
+    senderpcb->m_ipcStatus = SUCCESS;
+    processRemove(&gReplyBlockedQ, senderpcb);
+    processEnqueue(&gReadyToRunProcessQ, senderpcb);
+
+    char* errormessage = "kernelReply";
+    handoff(&gReadyToRunProcessQ, currpcb, senderpcb, ctx, errormessage);
+    return SUCCESS;
+}
+
+// Copies len bytes from src in process pid into dest in the caller. pid must be blocked waiting
+// for the caller's Reply, so its memory stays put while we read it
+int kernelCopyFrom(int pid, void* dest, void* src, int len)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    PCB* senderpcb = getPcbByPid(&gReplyBlockedQ, pid);
+    if(senderpcb == NULL || senderpcb->m_ipcPartner != currpcb->m_pid ||
+       checkProcessRange(currpcb, (unsigned int)dest, len, 1) != SUCCESS)
+    {
+        return ERROR;
+    }
+    if(resolveCopyOnWrite(currpcb, (unsigned int)dest, len) != SUCCESS)
+    {
+        return ERROR;
+    }
+    return copyProcessMemory(senderpcb, (unsigned int)src, (char*)dest, len, 0);
+}
+
+// Copies len bytes from src in the caller into dest in process pid, which must be blocked waiting
+// for the caller's Reply
+int kernelCopyTo(int pid, void* dest, void* src, int len)
+{
+    PCB* currpcb = getHeadProcess(&gRunningProcessQ);
+    PCB* senderpcb = getPcbByPid(&gReplyBlockedQ, pid);
+    if(senderpcb == NULL || senderpcb->m_ipcPartner != currpcb->m_pid ||
+       checkProcessRange(currpcb, (unsigned int)src, len, 0) != SUCCESS)
+    {
+        return ERROR;
+    }
+    return copyProcessMemory(senderpcb, (unsigned int)dest, (char*)src, len, 1);
+}
+
+// Called when pcb exits. Drops its server registrations and fails every Send still waiting on it.
+// Receivers waiting for pcb specifically are woken so they can notice it is gone
+void ipcCleanup(PCB* pcb)
+{
+    int i;
+    for(i = 1; i <= MAX_SERVER_INDEX; i++)
+    {
+        if(gServerTable[i] == pcb->m_pid)
+        {
+            gServerTable[i] = -1;
+        }
+    }
+
+    // senders never received keep m_ipcStatus ERROR
+    if(pcb->m_senderQ != NULL)
+    {
+        processQueueAppend(&gReadyToRunProcessQ, pcb->m_senderQ);
+    }
+
+    PCB* curr = gReplyBlockedQ.m_head;
+    while(curr != NULL)
+    {
+        PCB* next = curr->m_next;
+        if(curr->m_ipcPartner == pcb->m_pid)
+        {
+            processRemove(&gReplyBlockedQ, curr);
+            processEnqueue(&gReadyToRunProcessQ, curr);
+        }
+        curr = next;
+    }
+
+    curr = gReceiveBlockedQ.m_head;
+    while(curr != NULL)
+    {
+        PCB* next = curr->m_next;
+        if(curr->m_ipcPartner == pcb->m_pid)
+        {
+            processRemove(&gReceiveBlockedQ, curr);
+            processEnqueue(&gReadyToRunProcessQ, curr);
+        }
+        curr = next;
+    }
+}
@@ -1,19 +1,245 @@
 #include <terminal.h>
 #include <yalnixutils.h>
+#include <scheduler.h>
 
-int removeTerminalRequest(TerminalRequest* request)
+void initTerminalRequestPool(int tty_id)
 {
-    if(request != NULL)
+    TerminalRequestPool* pool = &gTermRequestPool[tty_id];
+    int i;
+    pool->m_free = NULL;
+    for(i = TERM_MAX_REQUESTS - 1; i >= 0; i--)
     {
-        SAFE_FREE(request->m_bufferR0);
-        SAFE_FREE(request->m_bufferR1);
-        SAFE_FREE(request);
-        return 0;
+        pool->m_requests[i].m_next = pool->m_free;
+        pool->m_free = &pool->m_requests[i];
     }
-    else
+}
+
+TerminalRequest* getTerminalRequest(int tty_id)
+{
+    TerminalRequestPool* pool = &gTermRequestPool[tty_id];
+    TerminalRequest* request = pool->m_free;
+    if(request == NULL)
     {
-        TracePrintf(MODERATE, "ERROR: NULL request provided to delete\n");
+        return NULL;
+    }
+    pool->m_free = request->m_next;
+
+    // the staging buffer belongs to the slot, so it survives the clearing
+    int slot = request - pool->m_requests;
+    memset(request, 0, sizeof(TerminalRequest));
+    request->m_bufferR0 = pool->m_buffers[slot];
+    return request;
+}
+
+int removeTerminalRequest(int tty_id, TerminalRequest* request)
+{
+    TerminalRequestPool* pool = &gTermRequestPool[tty_id];
+    if(request == NULL || request < pool->m_requests || request >= pool->m_requests + TERM_MAX_REQUESTS)
+    {
+        TracePrintf(MODERATE, "ERROR: Request is not from the pool of terminal %d\n", tty_id);
         return ERROR;
     }
 
+    // neither buffer is ours to free: R0 is the pool's staging buffer and R1 is the caller's
+    request->m_pcb = NULL;
+    request->m_next = pool->m_free;
+    pool->m_free = request;
+    return 0;
+}
+
+int termOutputAppend(int tty_id, char* buf, int len)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    int space = TERM_OUTPUT_LEN - out->m_len;
+    if(len > space) len = space;
+
+    // the free part of the ring may wrap around its end
+    int tail = (out->m_head + out->m_len) % TERM_OUTPUT_LEN;
+    int first = TERM_OUTPUT_LEN - tail;
+    if(first > len) first = len;
+    memcpy(out->m_ring + tail, buf, first);
+    memcpy(out->m_ring, buf + first, len - first);
+    out->m_len += len;
+    out->m_accepted += len;
+    return len;
+}
+
+void termStartTransmit(int tty_id)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    if(out->m_inFlight > 0) return;
+
+    // nothing new goes into the ring while a pinned write owns the terminal, so it follows the ring's contents
+    TerminalRequest* pinned = out->m_pinned;
+    if(out->m_len == 0 && pinned != NULL && pinned->m_remaining > 0)
+    {
+        // the writer is blocked, so its pages stay put. stage just the chunk that goes out now
+        int chunk = pinned->m_remaining;
+        if(chunk > TERMINAL_MAX_LINE) chunk = TERMINAL_MAX_LINE;
+        unsigned int addr = (unsigned int)pinned->m_bufferR1 + pinned->m_serviced;
+        if(copyProcessMemory(pinned->m_pcb, addr, out->m_staging, chunk, 0) != SUCCESS)
+        {
+            TracePrintf(MODERATE, "ERROR: Lost the pages of the pinned write of process %d\n", pinned->m_pcb->m_pid);
+            pinned->m_remaining = 0;
+            processRemove(&gWriteWaitQ[tty_id], pinned->m_pcb);
+            processEnqueue(&gReadyToRunProcessQ, pinned->m_pcb);
+            return;
+        }
+        out->m_inFlight = chunk;
+        out->m_inFlightPinned = 1;
+        out->m_accepted += chunk;
+        TtyTransmit(tty_id, out->m_staging, chunk);
+        return;
+    }
+    if(out->m_len == 0) return;
+
+    // send everything that is pending, whoever wrote it, up to a full line. Writes went into the ring
+    // whole, so batching them does not mix one write into another
+    int chunk = out->m_len;
+    if(chunk > TERMINAL_MAX_LINE) chunk = TERMINAL_MAX_LINE;
+    out->m_inFlight = chunk;
+
+    // the hardware needs a contiguous buffer. only a chunk that wraps around the ring is copied
+    int first = TERM_OUTPUT_LEN - out->m_head;
+    if(first >= chunk)
+    {
+        TtyTransmit(tty_id, out->m_ring + out->m_head, chunk);
+    }
+    else
+    {
+        memcpy(out->m_staging, out->m_ring + out->m_head, first);
+        memcpy(out->m_staging + first, out->m_ring, chunk - first);
+        TtyTransmit(tty_id, out->m_staging, chunk);
+    }
+}
+
+void termTransmitDone(int tty_id)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    if(out->m_inFlightPinned)
+    {
+        TerminalRequest* pinned = out->m_pinned;
+        pinned->m_serviced += out->m_inFlight;
+        pinned->m_remaining -= out->m_inFlight;
+        if(pinned->m_remaining == 0)
+        {
+            // all out. the writer takes it from here
+            processRemove(&gWriteWaitQ[tty_id], pinned->m_pcb);
+            processEnqueue(&gReadyToRunProcessQ, pinned->m_pcb);
+        }
+        out->m_inFlightPinned = 0;
+    }
+    else
+    {
+        out->m_head = (out->m_head + out->m_inFlight) % TERM_OUTPUT_LEN;
+        out->m_len -= out->m_inFlight;
+    }
+    out->m_sent += out->m_inFlight;
+    out->m_inFlight = 0;
+    out->m_transmits++;
+    termStartTransmit(tty_id);
+}
+
+void termWakeWriter(int tty_id)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    PCBQueue* waitQ = &gWriteWaitQ[tty_id];
+
+    // a pinned writer is woken by the transmit interrupt alone.
+    // a writer that owns the terminal goes first, wherever it sits in the queue.
+    // otherwise queued asynchronous writes go before anybody else
+    if(out->m_pinned != NULL) return;
+    if(out->m_writer == NULL && termRequestsPending(tty_id)) return;
+    PCB* next = (out->m_writer != NULL) ? out->m_writer : getHeadProcess(waitQ);
+    if(next == NULL || getPcbByPid(waitQ, next->m_pid) != next) return;
+    if(TERM_OUTPUT_LEN - out->m_len < next->m_waitLength) return;
+
+    processRemove(waitQ, next);
+    processEnqueue(&gReadyToRunProcessQ, next);
+    out->m_writer = next;
+}
+
+void termReceive(int tty_id)
+{
+    TerminalInput* input = &gTermInput[tty_id];
+    char line[TERMINAL_MAX_LINE];
+    int read = TtyReceive(tty_id, line, TERMINAL_MAX_LINE);
+    input->m_received += read;
+    input->m_receives++;
+    input->m_lastReceive = gClockTicks;
+    if(read > TERM_INPUT_LEN - input->m_len)
+    {
+        TracePrintf(MODERATE, "Input buffer of terminal %d is full. Dropping %d bytes\n", tty_id, read - (TERM_INPUT_LEN - input->m_len));
+        read = TERM_INPUT_LEN - input->m_len;
+    }
+    memcpy(input->m_buffer + input->m_len, line, read);
+    input->m_len += read;
+}
+
+void termWakeReader(int tty_id)
+{
+    PCB* next = getHeadProcess(&gReadBlockedQ[tty_id]);
+    if(next != NULL && gTermInput[tty_id].m_len > 0)
+    {
+        processRemove(&gReadBlockedQ[tty_id], next);
+        processEnqueue(&gReadyToRunProcessQ, next);
+    }
+}
+
+bool termRequestsPending(int tty_id)
+{
+    TerminalRequest* req = gTermWReqHeads[tty_id].m_next;
+    while(req != NULL)
+    {
+        if(req->m_remaining > 0) return true;
+        req = req->m_next;
+    }
+    return false;
+}
+
+void termFillFromRequests(int tty_id)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    if(out->m_writer != NULL) return;
+
+    TerminalRequest* req = gTermWReqHeads[tty_id].m_next;
+    while(req != NULL)
+    {
+        if(req->m_remaining > 0)
+        {
+            int moved = termOutputAppend(tty_id, (char*)req->m_bufferR0 + req->m_serviced, req->m_remaining);
+            req->m_serviced += moved;
+            req->m_remaining -= moved;
+            if(req->m_remaining > 0) break;        // out of room. the rest keeps its place at the front
+
+            // all in. the request now only remembers where the write ends
+            req->m_endPos = out->m_accepted;
+        }
+        req = req->m_next;
+    }
+    termStartTransmit(tty_id);
+}
+
+int termReapRequests(int tty_id)
+{
+    TerminalOutput* out = &gTermOutput[tty_id];
+    TerminalRequest* prev = &gTermWReqHeads[tty_id];
+    TerminalRequest* req = prev->m_next;
+    int reaped = 0;
+    while(req != NULL)
+    {
+        TerminalRequest* next = req->m_next;
+        if(req->m_remaining == 0 && (int)(out->m_sent - req->m_endPos) >= 0)
+        {
+            prev->m_next = next;
+            removeTerminalRequest(tty_id, req);
+            reaped++;
+        }
+        else
+        {
+            prev = req;
+        }
+        req = next;
+    }
+    return reaped;
 }
@@ -0,0 +1,46 @@
+#include <yalnix.h>
+
+int main(int argc, char** argv)
+{
+    int n = 4;
+    int barrier_id = -1;
+    int rc = BarrierInit(&barrier_id, n);
+    int pid = GetPid();
+    if(rc == ERROR)
+    {
+        return ERROR;
+    }
+    TracePrintf(0, "Process %d before fork created barrier %d for %d processes.\n", pid, barrier_id, n);
+
+    // the parent and n - 1 children step through the phases together
+    int i;
+    for(i = 0; i < n - 1; i++)
+    {
+        if(Fork() == 0)
+        {
+            break;
+        }
+    }
+
+    int mypid = GetPid();
+    int phase;
+    for(phase = 0; phase < 3; phase++)
+    {
+        // stagger the arrivals so that everybody but the last process has to block
+        Delay(mypid % n + 1);
+        TracePrintf(0, "Process %d arrived at barrier %d in phase %d.\n", mypid, barrier_id, phase);
+        if(BarrierWait(barrier_id) == ERROR)
+        {
+            TracePrintf(0, "Process %d failed to wait on barrier %d.\n", mypid, barrier_id);
+            exit(-1);
+        }
+        TracePrintf(0, "Process %d left barrier %d in phase %d.\n", mypid, barrier_id, phase);
+    }
+
+    while(1)
+    {
+        TracePrintf(0, "Process : %d\n", mypid);
+        Pause();
+    }
+    return SUCCESS;
+}
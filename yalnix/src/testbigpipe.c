@@ -0,0 +1,76 @@
+#include <yalnix.h>
+
+#define BIG_PIPE_LEN    (3 * 8192)
+#define STREAM_LEN      (4 * BIG_PIPE_LEN + 100)
+#define CHUNK_LEN       5000
+
+char gBuffer[STREAM_LEN];
+
+int main(int argc, char** argv)
+{
+    int pipeId;
+    if(PipeInitEx(&pipeId, BIG_PIPE_LEN) != SUCCESS)
+    {
+        TracePrintf(0, "Error creating a page backed pipe\n");
+        exit(-1);
+    }
+
+    // a pipe this size is larger than the kernel allows
+    int tooBig;
+    if(PipeInitEx(&tooBig, 64 * 8192) != ERROR)
+    {
+        TracePrintf(0, "Oversized pipe was not rejected\n");
+    }
+
+    int krc = Fork();
+    if(krc == 0)
+    {
+        int cpid = GetPid();
+        int total = 0;
+        while(total < STREAM_LEN)
+        {
+            int len = STREAM_LEN - total;
+            if(len > CHUNK_LEN) len = CHUNK_LEN;
+            if(PipeReadExact(pipeId, gBuffer + total, len) != len)
+            {
+                TracePrintf(0, "Child Process : %d short read at offset %d\n", cpid, total);
+                exit(-1);
+            }
+            total += len;
+        }
+        int i;
+        for(i = 0; i < STREAM_LEN; i++)
+        {
+            if(gBuffer[i] != (char)(i % 251))
+            {
+                TracePrintf(0, "Child Process : %d read a bad byte at offset %d\n", cpid, i);
+                exit(-1);
+            }
+        }
+        TracePrintf(0, "Child Process : %d read all %d bytes\n", cpid, total);
+        exit(0);
+    }
+    else
+    {
+        int ppid = GetPid();
+        int i;
+        for(i = 0; i < STREAM_LEN; i++)
+        {
+            gBuffer[i] = (char)(i % 251);
+        }
+        int len = PipeWrite(pipeId, gBuffer, STREAM_LEN);
+        TracePrintf(0, "Parent Process : %d wrote %d bytes\n", ppid, len);
+        int status;
+        Wait(&status);
+        TracePrintf(0, "Parent Process : %d child exited with %d\n", ppid, status);
+        if(Reclaim(pipeId) != SUCCESS)
+        {
+            TracePrintf(0, "Unable to reclaim the pipe\n");
+        }
+        while(1)
+        {
+            Pause();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+#define COPY_SERVER 2
+#define DATA_LEN (3 * PAGESIZE + 100)
+
+char gData[DATA_LEN];       // spans several pages so the server has to copy across page boundaries
+
+// The client Sends the address and length of a buffer. The server pulls it over with CopyFrom,
+// changes every byte and pushes it back with CopyTo before replying
+int main(int argc, char** argv)
+{
+    int i;
+    if(Fork() == 0)
+    {
+        int mypid = GetPid();
+        if(Register(COPY_SERVER) == ERROR)
+        {
+            TracePrintf(0, "Server %d failed to register.\n", mypid);
+            exit(-1);
+        }
+        int msg[MESSAGE_SIZE / sizeof(int)];
+        int sender = Receive(msg);
+        void* addr = (void*)msg[0];
+        int len = msg[1];
+        if(CopyFrom(sender, gData, addr, len) == ERROR)
+        {
+            TracePrintf(0, "Server %d failed to copy from %d.\n", mypid, sender);
+            exit(-1);
+        }
+        for(i = 0; i < len; i++)
+        {
+            gData[i]++;
+        }
+        msg[0] = CopyTo(sender, addr, gData, len);
+        Reply(msg, sender);
+        exit(0);
+    }
+
+    // give the server a chance to register
+    Delay(2);
+
+    for(i = 0; i < DATA_LEN; i++)
+    {
+        gData[i] = i % 100;
+    }
+    int msg[MESSAGE_SIZE / sizeof(int)];
+    msg[0] = (int)gData;
+    msg[1] = DATA_LEN;
+    if(Send(msg, -COPY_SERVER) == ERROR || msg[0] == ERROR)
+    {
+        TracePrintf(0, "Copy through the server failed.\n");
+        exit(-1);
+    }
+    for(i = 0; i < DATA_LEN; i++)
+    {
+        if(gData[i] != i % 100 + 1)
+        {
+            TracePrintf(0, "Byte %d came back as %d instead of %d.\n", i, gData[i], i % 100 + 1);
+            exit(-1);
+        }
+    }
+    TracePrintf(0, "All %d bytes made the round trip through the server.\n", DATA_LEN);
+
+    while(1)
+    {
+        TracePrintf(0, "Process : %d\n", GetPid());
+        Pause();
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include <yalnix.h>
+
+#define ECHO_SERVER 1
+
+// A server registers an index and echoes every message back with its pid stamped in.
+// Clients Send to the index and block until the reply arrives
+int main(int argc, char** argv)
+{
+    int nclients = 3;
+    int i;
+
+    if(Fork() == 0)
+    {
+        int mypid = GetPid();
+        if(Register(ECHO_SERVER) == ERROR)
+        {
+            TracePrintf(0, "Server %d failed to register.\n", mypid);
+            exit(-1);
+        }
+        int msg[MESSAGE_SIZE / sizeof(int)];
+        int served;
+        for(served = 0; served < nclients * 2; served++)
+        {
+            int sender = Receive(msg);
+            if(sender == ERROR)
+            {
+                TracePrintf(0, "Server %d failed to receive.\n", mypid);
+                exit(-1);
+            }
+            TracePrintf(0, "Server %d received round %d from %d (sent by %d).\n", mypid, msg[1], sender, msg[0]);
+            msg[MESSAGE_SIZE / sizeof(int) - 1] = mypid;
+            Reply(msg, sender);
+        }
+        exit(0);
+    }
+
+    // give the server a chance to register
+    Delay(2);
+
+    for(i = 0; i < nclients; i++)
+    {
+        if(Fork() == 0)
+        {
+            break;
+        }
+    }
+
+    int mypid = GetPid();
+    int round;
+    for(round = 0; round < 2; round++)
+    {
+        int msg[MESSAGE_SIZE / sizeof(int)];
+        msg[0] = mypid;
+        msg[1] = round;
+        if(Send(msg, -ECHO_SERVER) == ERROR)
+        {
+            TracePrintf(0, "Process %d failed to send.\n", mypid);
+            exit(-1);
+        }
+        TracePrintf(0, "Process %d got its reply from server %d.\n", mypid, msg[MESSAGE_SIZE / sizeof(int) - 1]);
+    }
+
+    while(1)
+    {
+        TracePrintf(0, "Process : %d\n", mypid);
+        Pause();
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,50 @@
+#include <yalnix.h>
+
+// A parent creates a pipe and a lock, forks, writes and exits before the child gets to them.
+// The child still holds a reference, so both have to outlive their owner
+int main(int argc, char** argv)
+{
+    if(Fork() == 0)
+    {
+        int pipeId, lockId;
+        if(PipeInit(&pipeId) != SUCCESS || LockInit(&lockId) != SUCCESS)
+        {
+            TracePrintf(0, "Error creating the pipe and lock\n");
+            exit(-1);
+        }
+
+        if(Fork() == 0)
+        {
+            // let the parent write and exit first
+            Delay(3);
+            char buff[6];
+            int len = PipeRead(pipeId, buff, sizeof(buff));
+            if(len != 5 || buff[0] != 'h' || buff[4] != 'o')
+            {
+                TracePrintf(0, "Child read %d bytes from the orphaned pipe\n", len);
+                exit(-1);
+            }
+            if(Acquire(lockId) != SUCCESS || Release(lockId) != SUCCESS)
+            {
+                TracePrintf(0, "Child could not use the orphaned lock\n");
+                exit(-1);
+            }
+            TracePrintf(0, "Child used the pipe and lock after their owner exited\n");
+
+            // we are the last user, so this reclaims both
+            exit(0);
+        }
+
+        PipeWrite(pipeId, "hello", 5);
+        TracePrintf(0, "Owner wrote to the pipe and is exiting\n");
+        exit(0);
+    }
+
+    int status;
+    Wait(&status);
+    while(1)
+    {
+        Pause();
+    }
+    return 0;
+}
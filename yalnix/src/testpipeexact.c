@@ -0,0 +1,83 @@
+#include <yalnix.h>
+
+#define PIPE_LEN    256
+#define STREAM_LEN  2400
+
+char gBuffer[STREAM_LEN];
+
+// the writer sends whole writes of write_len bytes, the reader takes exact reads of read_len bytes.
+// neither size divides the other, so the pipe is never drained by a single read
+int runExact(int pipeId, int read_len, int write_len)
+{
+    int krc = Fork();
+    if(krc == 0)
+    {
+        char chunk[PIPE_LEN];
+        int total = 0;
+        int i;
+        while(total < STREAM_LEN)
+        {
+            int len = STREAM_LEN - total;
+            if(len > write_len) len = write_len;
+            for(i = 0; i < len; i++)
+            {
+                chunk[i] = (char)((total + i) % 251);
+            }
+            if(PipeWrite(pipeId, chunk, len) != len)
+            {
+                TracePrintf(0, "Writer short write at offset %d\n", total);
+                exit(-1);
+            }
+            total += len;
+        }
+        exit(0);
+    }
+
+    int total = 0;
+    while(total < STREAM_LEN)
+    {
+        int len = STREAM_LEN - total;
+        if(len > read_len) len = read_len;
+        if(PipeReadExact(pipeId, gBuffer + total, len) != len)
+        {
+            TracePrintf(0, "Reader short read at offset %d\n", total);
+            return ERROR;
+        }
+        total += len;
+    }
+    int status;
+    Wait(&status);
+
+    int i;
+    for(i = 0; i < STREAM_LEN; i++)
+    {
+        if(gBuffer[i] != (char)(i % 251))
+        {
+            TracePrintf(0, "Reader got a bad byte at offset %d\n", i);
+            return ERROR;
+        }
+    }
+    return SUCCESS;
+}
+
+// Exact reads against whole writes that do not line up with them must not deadlock
+int main(int argc, char** argv)
+{
+    int pipeId;
+    if(PipeInitEx(&pipeId, PIPE_LEN) != SUCCESS)
+    {
+        TracePrintf(0, "Error creating the pipe\n");
+        exit(-1);
+    }
+
+    // a read the size of the pipe against small writes that leave a gap at the end
+    if(runExact(pipeId, PIPE_LEN, 10) != SUCCESS) exit(-1);
+    TracePrintf(0, "Exact reads of %d against writes of %d passed\n", PIPE_LEN, 10);
+
+    // reads and writes that each fit but overlap in the pipe
+    if(runExact(pipeId, 200, 120) != SUCCESS) exit(-1);
+    TracePrintf(0, "Exact reads of %d against writes of %d passed\n", 200, 120);
+
+    Reclaim(pipeId);
+    exit(0);
+}
@@ -0,0 +1,76 @@
+#include <yalnix.h>
+
+#define STREAM_LEN  (4 * PIPE_BUFFER_LEN + 17)
+#define CHUNK_LEN   100
+
+int main(int argc, char** argv)
+{
+    int pipeId;
+    int rc = PipeInit(&pipeId);
+    if(rc != SUCCESS)
+    {
+        TracePrintf(0, "Error creating pipes\n");
+        exit(-1);
+    }
+
+    int krc = Fork();
+    if(krc == 0)
+    {
+        // the child drains the pipe in small pieces and checks the pattern
+        int cpid = GetPid();
+        char buff[CHUNK_LEN];
+        int total = 0;
+        while(total < STREAM_LEN)
+        {
+            // reads return as soon as there is something in the pipe, so take whatever we get
+            int len = STREAM_LEN - total;
+            if(len > CHUNK_LEN) len = CHUNK_LEN;
+            int got = PipeRead(pipeId, buff, len);
+            if(got <= 0 || got > len)
+            {
+                TracePrintf(0, "Child Process : %d read %d of %d bytes\n", cpid, got, len);
+                exit(-1);
+            }
+            int i;
+            for(i = 0; i < got; i++)
+            {
+                if(buff[i] != (char)('a' + (total + i) % 26))
+                {
+                    TracePrintf(0, "Child Process : %d read a bad byte at offset %d\n", cpid, total + i);
+                    exit(-1);
+                }
+            }
+            total += got;
+        }
+        TracePrintf(0, "Child Process : %d read all %d bytes\n", cpid, total);
+        exit(0);
+    }
+    else
+    {
+        // the parent writes more than the pipe can hold in a single call and blocks till it is all through
+        int ppid = GetPid();
+        char* msg = (char*)malloc(STREAM_LEN);
+        int i;
+        for(i = 0; i < STREAM_LEN; i++)
+        {
+            msg[i] = 'a' + i % 26;
+        }
+        TracePrintf(0, "Parent Process : %d writing %d bytes to pipe\n", ppid, STREAM_LEN);
+        int len = PipeWrite(pipeId, msg, STREAM_LEN);
+        if(len != STREAM_LEN)
+        {
+            TracePrintf(0, "Pipe Write Failed : %d\n", len);
+        }
+        free(msg);
+        int status;
+        Wait(&status);
+        TracePrintf(0, "Parent Process : %d child exited with %d\n", ppid, status);
+        while(1)
+        {
+            TracePrintf(0, "Parent process : %d\n", ppid);
+            Pause();
+        }
+    }
+
+    return 0;
+}
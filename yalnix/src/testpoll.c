@@ -0,0 +1,84 @@
+#include <yalnix.h>
+
+#define NUM_PRODUCERS   2
+#define NUM_MESSAGES    3
+
+int main(int argc, char** argv)
+{
+    int pipes[NUM_PRODUCERS];
+    int i;
+    for(i = 0; i < NUM_PRODUCERS; i++)
+    {
+        if(PipeInit(&pipes[i]) != SUCCESS)
+        {
+            TracePrintf(0, "Error creating pipes\n");
+            exit(-1);
+        }
+    }
+
+    // nothing has been written yet, so a zero timeout poll finds nothing
+    PollEntry entries[NUM_PRODUCERS + 1];
+    for(i = 0; i < NUM_PRODUCERS; i++)
+    {
+        entries[i].m_id = pipes[i];
+        entries[i].m_events = YPOLL_IN;
+    }
+    if(Poll(entries, NUM_PRODUCERS, 0) != 0)
+    {
+        TracePrintf(0, "Poll found data in empty pipes\n");
+    }
+    if(Poll(entries, NUM_PRODUCERS, 3) != 0)
+    {
+        TracePrintf(0, "Poll did not time out on empty pipes\n");
+    }
+
+    // each producer writes to its own pipe at its own pace
+    for(i = 0; i < NUM_PRODUCERS; i++)
+    {
+        if(Fork() == 0)
+        {
+            int pid = GetPid();
+            int m;
+            for(m = 0; m < NUM_MESSAGES; m++)
+            {
+                Delay(2 * (i + 1));
+                char msg = 'a' + i;
+                PipeWrite(pipes[i], &msg, 1);
+                TracePrintf(0, "Producer %d wrote message %d\n", pid, m);
+            }
+            exit(0);
+        }
+    }
+
+    // one process serves both pipes and the terminal without blocking on any single one
+    entries[NUM_PRODUCERS].m_id = 0;
+    entries[NUM_PRODUCERS].m_events = YPOLL_IN;
+    int received = 0;
+    while(received < NUM_PRODUCERS * NUM_MESSAGES)
+    {
+        int ready = Poll(entries, NUM_PRODUCERS + 1, -1);
+        TracePrintf(0, "Poll returned %d ready entries\n", ready);
+        for(i = 0; i < NUM_PRODUCERS; i++)
+        {
+            if(entries[i].m_revents & YPOLL_IN)
+            {
+                char buff[8];
+                int len = PipeRead(pipes[i], buff, sizeof(buff));
+                received += len;
+                TracePrintf(0, "Read %d bytes from pipe %d\n", len, i);
+            }
+        }
+        if(entries[NUM_PRODUCERS].m_revents & YPOLL_IN)
+        {
+            TracePrintf(0, "Terminal 0 has input waiting\n");
+            entries[NUM_PRODUCERS].m_events = 0;
+        }
+    }
+    TracePrintf(0, "Received all %d messages\n", received);
+
+    while(1)
+    {
+        Pause();
+    }
+    return 0;
+}
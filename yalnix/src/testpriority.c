@@ -0,0 +1,64 @@
+#include <yalnix.h>
+
+#define BUSY_TICKS  10
+
+// returns the clock ticks since boot
+int now()
+{
+    TtyStats stats;
+    TtyGetStats(0, &stats);
+    return stats.m_ticks;
+}
+
+// A high priority CPU loop against a low priority one. The clock must never hand the cpu
+// to the low priority process while the high priority one still wants it
+int main(int argc, char** argv)
+{
+    // the high priority child inherits our priority at fork
+    SetPriority(10);
+    int high = Fork();
+    if(high == 0)
+    {
+        int start = now();
+        while(now() < start + BUSY_TICKS)
+        {
+            // spin through several quanta
+        }
+        exit(now());
+    }
+
+    SetPriority(0);
+    int low = Fork();
+    if(low == 0)
+    {
+        // we only get here once the high priority child is done
+        int start = now();
+        while(now() < start + 2)
+        {
+        }
+        exit(start);
+    }
+
+    int status, highEnd = -1, lowStart = -1;
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+        int pid = Wait(&status);
+        if(pid == high) highEnd = status;
+        else if(pid == low) lowStart = status;
+    }
+
+    if(lowStart < highEnd)
+    {
+        TracePrintf(0, "Low priority loop ran at tick %d before the high priority one ended at %d\n", lowStart, highEnd);
+    }
+    else
+    {
+        TracePrintf(0, "High priority loop ended at tick %d, low priority one started at %d\n", highEnd, lowStart);
+    }
+    while(1)
+    {
+        Pause();
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <yalnix.h>
+
+int main(int argc, char** argv)
+{
+    int rwlock_id = -1;
+    int rc = RWLockInit(&rwlock_id);
+    int pid = GetPid();
+    if(rc == ERROR)
+    {
+        return ERROR;
+    }
+    TracePrintf(0, "Process %d before fork created reader-writer lock %d.\n", pid, rwlock_id);
+
+    // the parent reads first, then a writer and two readers queue up behind it
+    ReadAcquire(rwlock_id);
+
+    int i;
+    for(i = 0; i < 3; i++)
+    {
+        rc = Fork();
+        if(rc == 0)
+        {
+            int cpid = GetPid();
+            if(i == 0)
+            {
+                TracePrintf(0, "Child process %d waiting to write lock %d.\n", cpid, rwlock_id);
+                WriteAcquire(rwlock_id);
+                TracePrintf(0, "Child process %d holds lock %d for writing.\n", cpid, rwlock_id);
+                Pause();
+                RWRelease(rwlock_id);
+                TracePrintf(0, "Child process %d released lock %d for the waiting readers.\n", cpid, rwlock_id);
+            }
+            else
+            {
+                // the readers must queue behind the waiting writer
+                TracePrintf(0, "Child process %d waiting to read lock %d.\n", cpid, rwlock_id);
+                ReadAcquire(rwlock_id);
+                TracePrintf(0, "Child process %d holds lock %d for reading.\n", cpid, rwlock_id);
+                Pause();
+                RWRelease(rwlock_id);
+            }
+            while(1)
+            {
+                TracePrintf(0, "Child Process : %d\n", cpid);
+                Pause();
+            }
+        }
+        Pause();
+    }
+
+    TracePrintf(0, "Parent process %d releasing its read hold on lock %d.\n", pid, rwlock_id);
+    RWRelease(rwlock_id);
+    while(1)
+    {
+        TracePrintf(0, "Parent Process : %d\n", pid);
+        Pause();
+    }
+    return SUCCESS;
+}
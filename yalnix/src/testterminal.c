@@ -38,11 +38,15 @@ void testRead()
     char prompt[] = "Reading From Terminal 0 : ";
     TtyPrintf(0, prompt);
     char data[200];
-    TtyRead(0, data, 200);
+    int len = TtyRead(0, data, 200);
+    if(len == ERROR)
+    {
+        return;
+    }
 
     char prompt1[] = "Data Read : ";
     TtyPrintf(0, prompt1);
-    TtyPrintf(0, data);
+    TtyWrite(0, data, len);
 }
 
 int main(int argc, char** argv)
@@ -0,0 +1,59 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+// Prints status lines without waiting for the terminal and polls for input without blocking
+int main(int argc, char** argv)
+{
+    char line[] = "working on step xx\n";
+    int tickets[10];
+    int i;
+
+    // every call returns right away, the terminal catches up behind our back
+    for(i = 0; i < 10; i++)
+    {
+        line[16] = '0' + i / 10;
+        line[17] = '0' + i % 10;
+        tickets[i] = TtyWriteAsync(1, line, sizeof(line) - 1);
+        if(tickets[i] == WOULDBLOCK)
+        {
+            // the terminal only keeps so many writes outstanding. let the oldest finish and retry
+            TtyWaitTicket(1, tickets[0]);
+            tickets[i] = TtyWriteAsync(1, line, sizeof(line) - 1);
+        }
+        if(tickets[i] == ERROR || tickets[i] == WOULDBLOCK)
+        {
+            TracePrintf(0, "Async write %d failed.\n", i);
+            exit(-1);
+        }
+    }
+    TracePrintf(0, "Queued 10 writes, tickets %d to %d.\n", tickets[0], tickets[9]);
+
+    // the writes go out in order, so waiting on the last one waits for all of them
+    TtyWaitTicket(1, tickets[9]);
+    TracePrintf(0, "All writes transmitted.\n");
+
+    // a nonblocking write goes in whole or not at all
+    char done[] = "done writing\n";
+    while(TtyWriteNonblock(1, done, sizeof(done) - 1) == WOULDBLOCK)
+    {
+        Pause();
+    }
+
+    // keep computing while waiting for a line on terminal 1
+    char buf[TERMINAL_MAX_LINE];
+    int spins = 0;
+    int len;
+    while((len = TtyReadNonblock(1, buf, sizeof(buf))) == WOULDBLOCK)
+    {
+        spins++;
+        Pause();
+    }
+    TracePrintf(0, "Read %d bytes after %d tries.\n", len, spins);
+
+    while(1)
+    {
+        TracePrintf(0, "Process : %d\n", GetPid());
+        Pause();
+    }
+    return SUCCESS;
+}
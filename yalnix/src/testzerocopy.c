@@ -0,0 +1,73 @@
+#include <hardware.h>
+#include <yalnix.h>
+
+#define NUM_PAGES   4
+#define STREAM_LEN  (NUM_PAGES * PAGESIZE)
+
+int main(int argc, char** argv)
+{
+    int pipeId;
+    if(PipeInitEx(&pipeId, 2 * PAGESIZE) != SUCCESS)
+    {
+        TracePrintf(0, "Error creating a page backed pipe\n");
+        exit(-1);
+    }
+
+    // page aligned buffers let whole pages move by remapping instead of copying
+    char* raw = (char*)malloc(STREAM_LEN + PAGESIZE);
+    char* pages = (char*)UP_TO_PAGE(raw);
+
+    int krc = Fork();
+    if(krc == 0)
+    {
+        int cpid = GetPid();
+        int total = 0;
+        while(total < STREAM_LEN)
+        {
+            if(PipeReadExact(pipeId, pages + total, PAGESIZE) != PAGESIZE)
+            {
+                TracePrintf(0, "Child Process : %d short read at offset %d\n", cpid, total);
+                exit(-1);
+            }
+            total += PAGESIZE;
+        }
+        int i;
+        for(i = 0; i < STREAM_LEN; i++)
+        {
+            if(pages[i] != (char)(i / PAGESIZE + i % 7))
+            {
+                TracePrintf(0, "Child Process : %d read a bad byte at offset %d\n", cpid, i);
+                exit(-1);
+            }
+        }
+        // the pages we were handed are ours to write
+        pages[0] = 0;
+        TracePrintf(0, "Child Process : %d read all %d bytes\n", cpid, total);
+        exit(0);
+    }
+    else
+    {
+        int ppid = GetPid();
+        int i;
+        for(i = 0; i < STREAM_LEN; i++)
+        {
+            pages[i] = (char)(i / PAGESIZE + i % 7);
+        }
+        int len = PipeWrite(pipeId, pages, STREAM_LEN);
+        TracePrintf(0, "Parent Process : %d wrote %d bytes\n", ppid, len);
+
+        // overwriting the buffer right away must not change what the child reads
+        for(i = 0; i < STREAM_LEN; i++)
+        {
+            pages[i] = 0;
+        }
+        int status;
+        Wait(&status);
+        TracePrintf(0, "Parent Process : %d child exited with %d\n", ppid, status);
+        while(1)
+        {
+            Pause();
+        }
+    }
+    return 0;
+}
@@ -120,8 +120,9 @@ void freeRegionOneFrames(PCB* pcb)
     {
         if(pagetable->m_pte[pageNumber].valid == 1)
         {
-            freeOneFrame(&gFreeFramePool, &gUsedFramePool, pagetable->m_pte[pageNumber].pfn);
+            releaseFrame(pagetable->m_pte[pageNumber].pfn);
             pagetable->m_pte[pageNumber].valid = 0;
+            pagetable->m_cow[pageNumber] = 0;
         }
     }
 }
@@ -163,6 +164,140 @@ void setR1PageTableAlone(PCB* process)
     WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
 }
 
+void* mapKernelWindow(unsigned int page, unsigned int pfn)
+{
+    void* addr = (void*)(page * PAGESIZE);
+    gKernelPageTable.m_pte[page].valid = 1;
+    gKernelPageTable.m_pte[page].prot = PROT_READ | PROT_WRITE;
+    gKernelPageTable.m_pte[page].pfn = pfn;
+    WriteRegister(REG_TLB_FLUSH, (unsigned int)addr);
+    return addr;
+}
+
+void unmapKernelWindow(unsigned int page)
+{
+    gKernelPageTable.m_pte[page].valid = 0;
+    gKernelPageTable.m_pte[page].prot = 0;
+    gKernelPageTable.m_pte[page].pfn = 0;
+    WriteRegister(REG_TLB_FLUSH, (unsigned int)(page * PAGESIZE));
+}
+
+void shareFrame(unsigned int pfn)
+{
+    gFrameShareCount[pfn]++;
+}
+
+void releaseFrame(unsigned int pfn)
+{
+    if(gFrameShareCount[pfn] > 0)
+    {
+        // somebody else still maps this frame
+        gFrameShareCount[pfn]--;
+    }
+    else
+    {
+        freeOneFrame(&gFreeFramePool, &gUsedFramePool, pfn);
+    }
+}
+
+int copyFrame(unsigned int pfn)
+{
+    if(gFreeFramePool.m_next == NULL)
+    {
+        TracePrintf(MODERATE, "Could not find a free frame to copy frame %u\n", pfn);
+        return ERROR;
+    }
+    FrameTableEntry* frame = getOneFreeFrame(&gFreeFramePool, &gUsedFramePool);
+    void* src = mapKernelWindow(KWINDOW_PAGE0, pfn);
+    void* dest = mapKernelWindow(KWINDOW_PAGE1, frame->m_frameNumber);
+    memcpy(dest, src, PAGESIZE);
+    unmapKernelWindow(KWINDOW_PAGE0);
+    unmapKernelWindow(KWINDOW_PAGE1);
+    return frame->m_frameNumber;
+}
+
+int breakCopyOnWrite(PCB* pcb, int r1page)
+{
+    UserProgPageTable* pagetable = pcb->m_pagetable;
+    unsigned int pfn = pagetable->m_pte[r1page].pfn;
+    if(gFrameShareCount[pfn] > 0)
+    {
+        // still shared, so take a private copy and drop our reference to the shared one
+        int copy = copyFrame(pfn);
+        if(copy == ERROR) return ERROR;
+        releaseFrame(pfn);
+        pagetable->m_pte[r1page].pfn = copy;
+    }
+    // otherwise everybody else let go of the frame already and it is ours
+    pagetable->m_pte[r1page].prot = PROT_READ | PROT_WRITE;
+    pagetable->m_cow[r1page] = 0;
+    WriteRegister(REG_TLB_FLUSH, (r1page + gNumPagesR0) * PAGESIZE);
+    return SUCCESS;
+}
+
+int resolveCopyOnWrite(PCB* pcb, unsigned int addr, int len)
+{
+    if(len <= 0 || addr < VMEM_1_BASE) return SUCCESS;
+    int first = addr / PAGESIZE - gNumPagesR0;
+    int last = (addr + len - 1) / PAGESIZE - gNumPagesR0;
+    int pg;
+    for(pg = first; pg <= last && pg < gNumPagesR1; pg++)
+    {
+        if(pcb->m_pagetable->m_cow[pg] && breakCopyOnWrite(pcb, pg) != SUCCESS)
+        {
+            return ERROR;
+        }
+    }
+    return SUCCESS;
+}
+
+int checkProcessRange(PCB* pcb, unsigned int addr, int len, int write)
+{
+    if(len < 0 || addr < VMEM_1_BASE || addr + len > VMEM_1_LIMIT || addr + len < addr) return ERROR;
+    if(len == 0) return SUCCESS;
+
+    UserProgPageTable* pagetable = pcb->m_pagetable;
+    int first = addr / PAGESIZE - gNumPagesR0;
+    int last = (addr + len - 1) / PAGESIZE - gNumPagesR0;
+    int pg;
+    for(pg = first; pg <= last; pg++)
+    {
+        if(pagetable->m_pte[pg].valid == 0) return ERROR;
+        if(write && (pagetable->m_pte[pg].prot & PROT_WRITE) == 0 && pagetable->m_cow[pg] == 0) return ERROR;
+    }
+    return SUCCESS;
+}
+
+int copyProcessMemory(PCB* pcb, unsigned int addr, char* buf, int len, int toProcess)
+{
+    // check the whole range before touching anything so a bad copy leaves both sides alone
+    if(checkProcessRange(pcb, addr, len, toProcess) != SUCCESS) return ERROR;
+    if(len == 0) return SUCCESS;
+    if(toProcess && resolveCopyOnWrite(pcb, addr, len) != SUCCESS) return ERROR;
+
+    UserProgPageTable* pagetable = pcb->m_pagetable;
+    int pg;
+
+    // one page of the other process at a time through the kernel window
+    while(len > 0)
+    {
+        int pageOffset = addr % PAGESIZE;
+        int chunk = PAGESIZE - pageOffset;
+        if(chunk > len) chunk = len;
+
+        pg = addr / PAGESIZE - gNumPagesR0;
+        char* window = (char*)mapKernelWindow(KWINDOW_PAGE0, pagetable->m_pte[pg].pfn) + pageOffset;
+        if(toProcess) memcpy(window, buf, chunk);
+        else memcpy(buf, window, chunk);
+
+        addr += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+    unmapKernelWindow(KWINDOW_PAGE0);
+    return SUCCESS;
+}
+
 // Returns -1 in case  of ERROR
 // Returns 0 in case of success
 // NOTE: What about stack space that has grown down and then grown up?
@@ -180,6 +315,7 @@ int checkValidAddress(unsigned int addr, PCB* pcb)
     r1page -= gNumPagesR0;
 
     UserProgPageTable* currpt = pcb->m_pagetable;
-    if(currpt->m_pte[r1page].valid == 0 || (currpt->m_pte[r1page].prot & PROT_WRITE) == 0) return -1;
+    if(currpt->m_pte[r1page].valid == 0) return -1;
+    if((currpt->m_pte[r1page].prot & PROT_WRITE) == 0 && currpt->m_cow[r1page] == 0) return -1;
     else return 0;
 }